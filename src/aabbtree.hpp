@@ -0,0 +1,311 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "raylib.h"
+
+// Dynamic AABB tree for broad-phase queries over moving boxes. Every leaf holds
+// a copy of its box grown by a margin, so a box that moves a little stays
+// inside its leaf and costs nothing; only a box that leaves it gets reinserted.
+// Inserts pick the sibling that grows the tree's surface area the least, and
+// AVL-style rotations keep it balanced, so inserts, moves and queries are all
+// O(log n). A proxy (the leaf's node index) stays valid until it is removed.
+
+class AABBTree
+{
+    private:
+    static const int nullNode = -1;
+
+    struct Node
+    {
+        BoundingBox box;
+        void* data;
+        int parent;     //next free node while on the free list
+        int left;
+        int right;
+        int height;     //0 for leaves, -1 while free
+
+        bool isLeaf() const
+        {
+            return left == nullNode;
+        }
+    };
+
+    static const int maxHeight = 64;    //balanced, so never reached by anything that fits in memory
+
+    std::vector<Node> nodes;
+    int root;
+    int freeList;
+    float margin;
+
+    static BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+    {
+        return {{std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)},
+                {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)}};
+    }
+
+    //surface area (halved), the insert cost
+    static float area(const BoundingBox& box)
+    {
+        const float x = box.max.x - box.min.x;
+        const float y = box.max.y - box.min.y;
+        const float z = box.max.z - box.min.z;
+        return x*y + y*z + z*x;
+    }
+
+    static bool contains(const BoundingBox& outer, const BoundingBox& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+               outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+    }
+
+    int allocateNode()
+    {
+        if(freeList == nullNode)
+        {
+            nodes.push_back({});
+            freeList = nodes.size() - 1;
+            nodes[freeList].parent = nullNode;
+        }
+        const int index = freeList;
+        freeList = nodes[index].parent;
+        nodes[index].data = nullptr;
+        nodes[index].parent = nullNode;
+        nodes[index].left = nullNode;
+        nodes[index].right = nullNode;
+        nodes[index].height = 0;
+        return index;
+    }
+
+    void freeNode(int index)
+    {
+        nodes[index].parent = freeList;
+        nodes[index].height = -1;
+        freeList = index;
+    }
+
+    //box and height of an internal node from its children
+    void refit(int index)
+    {
+        Node& node = nodes[index];
+        node.box = merge(nodes[node.left].box, nodes[node.right].box);
+        node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+    }
+
+    void replaceChild(int parent, int oldChild, int newChild)
+    {
+        if(parent == nullNode) {root = newChild;}
+        else if(nodes[parent].left == oldChild) {nodes[parent].left = newChild;}
+        else {nodes[parent].right = newChild;}
+    }
+
+    //rotates the taller child of a up if the subtree is out of balance; returns the subtree's new root
+    int balance(int a)
+    {
+        if(nodes[a].isLeaf() || nodes[a].height < 2) {return a;}
+
+        const int b = nodes[a].left;
+        const int c = nodes[a].right;
+        const int skew = nodes[c].height - nodes[b].height;
+
+        if(skew > 1)
+        {
+            const int f = nodes[c].left;
+            const int g = nodes[c].right;
+
+            nodes[c].left = a;
+            nodes[c].parent = nodes[a].parent;
+            nodes[a].parent = c;
+            replaceChild(nodes[c].parent, a, c);
+
+            //the taller grandchild stays under c
+            const int keep = nodes[f].height > nodes[g].height ? f : g;
+            const int move = keep == f ? g : f;
+            nodes[c].right = keep;
+            nodes[a].right = move;
+            nodes[move].parent = a;
+            refit(a);
+            refit(c);
+            return c;
+        }
+        if(skew < -1)
+        {
+            const int d = nodes[b].left;
+            const int e = nodes[b].right;
+
+            nodes[b].left = a;
+            nodes[b].parent = nodes[a].parent;
+            nodes[a].parent = b;
+            replaceChild(nodes[b].parent, a, b);
+
+            const int keep = nodes[d].height > nodes[e].height ? d : e;
+            const int move = keep == d ? e : d;
+            nodes[b].right = keep;
+            nodes[a].left = move;
+            nodes[move].parent = a;
+            refit(a);
+            refit(b);
+            return b;
+        }
+        return a;
+    }
+
+    //fixes boxes and heights from index up to the root
+    void walkUp(int index)
+    {
+        while(index != nullNode)
+        {
+            index = balance(index);
+            refit(index);
+            index = nodes[index].parent;
+        }
+    }
+
+    void insertLeaf(int leaf)
+    {
+        if(root == nullNode)
+        {
+            root = leaf;
+            nodes[root].parent = nullNode;
+            return;
+        }
+
+        //descend toward the sibling whose merge adds the least area
+        const BoundingBox leafBox = nodes[leaf].box;
+        int index = root;
+        while(!nodes[index].isLeaf())
+        {
+            const float combinedArea = area(merge(nodes[index].box, leafBox));
+            const float cost = 2*combinedArea;
+            const float inheritance = 2*(combinedArea - area(nodes[index].box));
+
+            float childCost[2];
+            const int children[2] = {nodes[index].left, nodes[index].right};
+            for(int i = 0; i < 2; i++)
+            {
+                const Node& child = nodes[children[i]];
+                childCost[i] = area(merge(leafBox, child.box)) + inheritance;
+                if(!child.isLeaf()) {childCost[i] -= area(child.box);}
+            }
+
+            if(cost < childCost[0] && cost < childCost[1]) {break;}
+            index = childCost[0] < childCost[1] ? children[0] : children[1];
+        }
+
+        const int sibling = index;
+        const int oldParent = nodes[sibling].parent;
+        const int newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].left = sibling;
+        nodes[newParent].right = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+        replaceChild(oldParent, sibling, newParent);
+
+        walkUp(newParent);
+    }
+
+    void removeLeaf(int leaf)
+    {
+        if(leaf == root)
+        {
+            root = nullNode;
+            return;
+        }
+
+        const int parent = nodes[leaf].parent;
+        const int grandParent = nodes[parent].parent;
+        const int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+        replaceChild(grandParent, parent, sibling);
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        walkUp(grandParent);
+    }
+
+    public:
+    AABBTree(float fatMargin = 1.0f) : root(nullNode), freeList(nullNode), margin(fatMargin) {}
+
+    int insert(BoundingBox box, void* data)
+    {
+        const int proxy = allocateNode();
+        nodes[proxy].box = {{box.min.x - margin, box.min.y - margin, box.min.z - margin},
+                            {box.max.x + margin, box.max.y + margin, box.max.z + margin}};
+        nodes[proxy].data = data;
+        insertLeaf(proxy);
+        return proxy;
+    }
+
+    void remove(int proxy)
+    {
+        removeLeaf(proxy);
+        freeNode(proxy);
+    }
+
+    //returns true when the box left its leaf and was reinserted
+    bool move(int proxy, BoundingBox box)
+    {
+        if(contains(nodes[proxy].box, box)) {return false;}
+
+        removeLeaf(proxy);
+        nodes[proxy].box = {{box.min.x - margin, box.min.y - margin, box.min.z - margin},
+                            {box.max.x + margin, box.max.y + margin, box.max.z + margin}};
+        insertLeaf(proxy);
+        return true;
+    }
+
+    void* getData(int proxy)
+    {
+        return nodes[proxy].data;
+    }
+
+    //the grown box the tree holds, not the one passed in
+    BoundingBox getFatBox(int proxy)
+    {
+        return nodes[proxy].box;
+    }
+
+    //calls visit(proxy) for every leaf whose fat box overlaps box; visit must not change the tree
+    template<typename Visit>
+    void query(BoundingBox box, Visit visit)
+    {
+        if(root == nullNode) {return;}
+
+        //plain array and pointer walk, this is the hot loop
+        const Node* tree = nodes.data();
+        int stack[maxHeight + 1];
+        int top = 0;
+        stack[top++] = root;
+        while(top > 0)
+        {
+            const int index = stack[--top];
+            const Node* node = tree + index;
+            if(node->box.max.x < box.min.x || node->box.min.x > box.max.x ||
+               node->box.max.y < box.min.y || node->box.min.y > box.max.y ||
+               node->box.max.z < box.min.z || node->box.min.z > box.max.z) {continue;}
+
+            if(node->left == nullNode)
+            {
+                visit(index);
+            }
+            else
+            {
+                stack[top++] = node->left;
+                stack[top++] = node->right;
+            }
+        }
+    }
+
+    int height()
+    {
+        return root == nullNode ? 0 : nodes[root].height;
+    }
+
+    void clear()
+    {
+        nodes.clear();
+        root = nullNode;
+        freeList = nullNode;
+    }
+};
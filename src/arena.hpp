@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Bump allocator for data that lives no longer than one frame, or one tick
+// on the simulation thread. allocate() moves an offset inside one block and
+// reset() rewinds it, so a frame's worth of scratch costs no frees. Requests
+// the block can't fit go to the heap and are freed at the next reset; the
+// high-water mark tells how big the block should be. Each thread has its own
+// arena (frameArena), so nothing is locked and nothing may cross threads or
+// outlive the reset of the thread that allocated it.
+
+class FrameArena
+{
+    private:
+    struct Overflow
+    {
+        void* memory;
+        size_t align;
+    };
+
+    char* block;
+    size_t capacity;
+    size_t used;
+    size_t overflowBytes;       //gone to the heap since the last reset
+    size_t highWater;           //most ever in use between two resets
+    std::vector<Overflow> overflow;
+
+    public:
+    FrameArena(size_t bytes) : capacity(bytes), used(0), overflowBytes(0), highWater(0)
+    {
+        block = (char*)malloc(capacity);
+    }
+
+    ~FrameArena()
+    {
+        reset();
+        free(block);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    //align must be a power of two. malloc only promises max_align_t, so the
+    //address is rounded up rather than the offset
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+    {
+        const uintptr_t base = (uintptr_t)block;
+        const size_t start = ((base + used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if(start + bytes <= capacity)
+        {
+            used = start + bytes;
+            return block + start;
+        }
+
+        void* memory = ::operator new(bytes, std::align_val_t(align));
+        overflow.push_back({memory, align});
+        overflowBytes += bytes;
+        return memory;
+    }
+
+    //everything handed out since the last reset is gone
+    void reset()
+    {
+        if(used + overflowBytes > highWater) {highWater = used + overflowBytes;}
+        for(const Overflow& spill : overflow) {::operator delete(spill.memory, std::align_val_t(spill.align));}
+        overflow.clear();
+        used = 0;
+        overflowBytes = 0;
+    }
+
+    size_t highWaterMark()
+    {
+        return used + overflowBytes > highWater ? used + overflowBytes : highWater;
+    }
+
+    size_t size()
+    {
+        return capacity;
+    }
+};
+
+//one arena per thread; the render loop resets the main thread's after every
+//frame, the simulation thread resets its own after every tick
+inline thread_local FrameArena frameArena(256*1024);
+
+//lets standard containers draw from an arena; deallocate is a no-op, so
+//reserve up front rather than growing
+template<typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+    FrameArena* arena;
+
+    FrameAllocator(FrameArena& owner) : arena(&owner) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n)
+    {
+        return (T*)arena->allocate(n*sizeof(T), alignof(T));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const
+    {
+        return arena == other.arena;
+    }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include "raylib.h"
+#include "raymath.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define BUOYANCY_SSE2 1
+#endif
+
+// Hull buoyancy. The sea is a few travelling waves summed into one height
+// field, so ships side by side ride the same swell instead of each bobbing on
+// its own sine. Every tick the solver takes all afloat hulls in one batch:
+// it samples the water under eight points of each hull (two rows of four
+// along the keel), turns how deep each point sits into a damped spring force
+// and integrates heave, pitch and roll as one rigid body per hull. Sample
+// points are kept as structure-of-arrays, so the water sampling, which is
+// most of the cost, is one 4-wide pass over every point of every hull.
+
+struct SeaWave
+{
+    float amplitude;
+    float kx;           //wave vector: travel direction times 2*pi/wavelength
+    float kz;
+    float omega;        //radians per tick
+};
+
+inline SeaWave makeSeaWave(float amplitude, float wavelength, float heading, float periodTicks)
+{
+    const float k = 2*PI/wavelength;
+    return {amplitude, k*sinf(heading*DEG2RAD), k*cosf(heading*DEG2RAD), 2*PI/periodTicks};
+}
+
+//a long swell that lifts whole hulls, a cross sea and a short chop that rocks them
+const int seaWaveCount = 3;
+inline const SeaWave seaWaves[seaWaveCount] = {
+    makeSeaWave(0.30f, 26.0f, 20.0f, 300.0f),
+    makeSeaWave(0.15f, 11.0f, 75.0f, 190.0f),
+    makeSeaWave(0.07f, 5.5f, -40.0f, 130.0f),
+};
+
+//each wave's phase at tick, wrapped in double so the float arguments stay small
+inline void seaPhases(unsigned long long int tick, float phase[seaWaveCount])
+{
+    for(int k = 0; k < seaWaveCount; k++)
+    {
+        phase[k] = (float)fmod((double)seaWaves[k].omega*(double)tick, 2*PI);
+    }
+}
+
+//sine to within about 4e-6: reduced to [-pi, pi], folded onto [-pi/2, pi/2],
+//then a Taylor polynomial to x^9. seaSin4 does the same arithmetic four wide,
+//so both paths give the same heights
+inline float seaSin(float x)
+{
+    x -= rintf(x*0.15915494f)*6.2831853f;
+    x = fminf(x, 3.1415927f - x);
+    x = fmaxf(x, -3.1415927f - x);
+    const float x2 = x*x;
+    return x*(1 + x2*(-1.0f/6 + x2*(1.0f/120 + x2*(-1.0f/5040 + x2*(1.0f/362880)))));
+}
+
+#if defined(BUOYANCY_SSE2)
+//seaSin's constants, built once per batch rather than once per call
+struct SeaSinConstants
+{
+    __m128 inverseTurn, turn, halfTurn, minusHalfTurn;
+    __m128 c3, c5, c7, c9, one;
+
+    SeaSinConstants()
+    {
+        inverseTurn = _mm_set1_ps(0.15915494f);
+        turn = _mm_set1_ps(6.2831853f);
+        halfTurn = _mm_set1_ps(3.1415927f);
+        minusHalfTurn = _mm_set1_ps(-3.1415927f);
+        c3 = _mm_set1_ps(-1.0f/6);
+        c5 = _mm_set1_ps(1.0f/120);
+        c7 = _mm_set1_ps(-1.0f/5040);
+        c9 = _mm_set1_ps(1.0f/362880);
+        one = _mm_set1_ps(1);
+    }
+};
+
+inline __m128 seaSin4(__m128 x, const SeaSinConstants& k)
+{
+    const __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, k.inverseTurn)));
+    x = _mm_sub_ps(x, _mm_mul_ps(turns, k.turn));
+    x = _mm_min_ps(x, _mm_sub_ps(k.halfTurn, x));
+    x = _mm_max_ps(x, _mm_sub_ps(k.minusHalfTurn, x));
+    const __m128 x2 = _mm_mul_ps(x, x);
+    __m128 poly = _mm_add_ps(k.c7, _mm_mul_ps(x2, k.c9));
+    poly = _mm_add_ps(k.c5, _mm_mul_ps(x2, poly));
+    poly = _mm_add_ps(k.c3, _mm_mul_ps(x2, poly));
+    poly = _mm_add_ps(k.one, _mm_mul_ps(x2, poly));
+    return _mm_mul_ps(x, poly);
+}
+#endif
+
+//water height at n points at tick
+inline void sampleSea(unsigned long long int tick, const float* x, const float* z, float* height, int n)
+{
+    float phase[seaWaveCount];
+    seaPhases(tick, phase);
+    int i = 0;
+
+#if defined(BUOYANCY_SSE2)
+    const SeaSinConstants constants;
+    __m128 amplitude[seaWaveCount], kx[seaWaveCount], kz[seaWaveCount], shift[seaWaveCount];
+    for(int k = 0; k < seaWaveCount; k++)
+    {
+        amplitude[k] = _mm_set1_ps(seaWaves[k].amplitude);
+        kx[k] = _mm_set1_ps(seaWaves[k].kx);
+        kz[k] = _mm_set1_ps(seaWaves[k].kz);
+        shift[k] = _mm_set1_ps(phase[k]);
+    }
+    for(; i + 4 <= n; i += 4)
+    {
+        const __m128 px = _mm_loadu_ps(x + i);
+        const __m128 pz = _mm_loadu_ps(z + i);
+        __m128 sum = _mm_setzero_ps();
+        for(int k = 0; k < seaWaveCount; k++)
+        {
+            const __m128 angle = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(px, kx[k]), _mm_mul_ps(pz, kz[k])), shift[k]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(amplitude[k], seaSin4(angle, constants)));
+        }
+        _mm_storeu_ps(height + i, sum);
+    }
+#endif
+
+    for(; i < n; i++)
+    {
+        float sum = 0;
+        for(int k = 0; k < seaWaveCount; k++)
+        {
+            const SeaWave& wave = seaWaves[k];
+            sum += wave.amplitude*seaSin((x[i]*wave.kx + z[i]*wave.kz) - phase[k]);
+        }
+        height[i] = sum;
+    }
+}
+
+inline float seaHeight(unsigned long long int tick, float x, float z)
+{
+    float height;
+    sampleSea(tick, &x, &z, &height, 1);
+    return height;
+}
+
+//heave in world units above the hull's rest height, pitch (bow up) and roll
+//(starboard up) in radians, each with its rate per tick
+struct HullMotion
+{
+    float heave;
+    float heaveRate;
+    float pitch;
+    float pitchRate;
+    float roll;
+    float rollRate;
+};
+
+class BuoyancySolver
+{
+    private:
+    static const int points = 8;
+    static constexpr float draft = 0.25f;           //how deep each point sits in still water
+    static constexpr float stiffness = 0.0039f;     //per point, about a 100 tick heave period
+    static constexpr float damping = 0.044f;        //about a third of critical
+    static constexpr float maxRate = 0.05f;         //heave per tick, part of maxHullStep
+    static constexpr float maxTilt = 0.35f;
+
+    //sample points around the hull's centre: x across the beam, z along the keel
+    float pointX[points];
+    float pointZ[points];
+    float offsetX[points];  //the same in the ship's frame
+    float offsetZ[points];
+    float pitchInertia;     //mean z^2 and x^2, so every mode rings at the heave period
+    float rollInertia;
+
+    std::vector<float> shipX, shipZ, cosHeading, sinHeading;
+    std::vector<HullMotion> motion;
+    std::vector<float> sampleX, sampleZ, water;
+    int count;
+
+    public:
+    //half is the hull's half size, offset where its centre sits in the ship's frame
+    BuoyancySolver(Vector3 half, Vector3 offset) : count(0)
+    {
+        pitchInertia = 0;
+        rollInertia = 0;
+        for(int i = 0; i < points; i++)
+        {
+            pointX[i] = (i%2 ? 0.8f : -0.8f)*half.x;
+            pointZ[i] = (-0.75f + 0.5f*(i/2))*half.z;
+            offsetX[i] = offset.x + pointX[i];
+            offsetZ[i] = offset.z + pointZ[i];
+            pitchInertia += pointZ[i]*pointZ[i]/points;
+            rollInertia += pointX[i]*pointX[i]/points;
+        }
+    }
+
+    //starts a tick's batch
+    void begin()
+    {
+        count = 0;
+    }
+
+    //the heading as its cosine and sine; returns the hull's index in this batch
+    int add(Vector3 position, float cosine, float sine, const HullMotion& current)
+    {
+        if(count == (int)motion.size())
+        {
+            for(std::vector<float>* field : {&shipX, &shipZ, &cosHeading, &sinHeading}) {field->resize(count + 1);}
+            motion.resize(count + 1);
+            for(std::vector<float>* field : {&sampleX, &sampleZ, &water}) {field->resize((count + 1)*points);}
+        }
+
+        shipX[count] = position.x;
+        shipZ[count] = position.z;
+        cosHeading[count] = cosine;
+        sinHeading[count] = sine;
+        motion[count] = current;
+        return count++;
+    }
+
+    //raw pointers throughout: the default build doesn't inline vector indexing
+    void solve(unsigned long long int tick)
+    {
+        const float* x = shipX.data();
+        const float* z = shipZ.data();
+        const float* c = cosHeading.data();
+        const float* s = sinHeading.data();
+        float* px = sampleX.data();
+        float* pz = sampleZ.data();
+        for(int i = 0; i < count; i++)
+        {
+            for(int j = 0; j < points; j++)
+            {
+                px[j] = x[i] + offsetX[j]*c[i] + offsetZ[j]*s[i];
+                pz[j] = z[i] - offsetX[j]*s[i] + offsetZ[j]*c[i];
+            }
+            px += points;
+            pz += points;
+        }
+
+        sampleSea(tick, sampleX.data(), sampleZ.data(), water.data(), count*points);
+
+        const float* height = water.data();
+        HullMotion* hull = motion.data();
+        for(int i = 0; i < count; i++, hull++, height += points)
+        {
+            float lift = 0;
+            float pitching = 0;
+            float rolling = 0;
+            for(int j = 0; j < points; j++)
+            {
+                const float depth = height[j] - (hull->heave + pointZ[j]*hull->pitch + pointX[j]*hull->roll) + draft;
+                if(depth <= 0) {continue;}
+                const float rate = hull->heaveRate + pointZ[j]*hull->pitchRate + pointX[j]*hull->rollRate;
+                const float push = stiffness*fminf(depth, 2*draft) - damping*rate;
+                lift += push;
+                pitching += pointZ[j]*push;
+                rolling += pointX[j]*push;
+            }
+
+            //gravity is what holds a hull at its draft on still water
+            hull->heaveRate = Clamp(hull->heaveRate + lift/points - stiffness*draft, -maxRate, maxRate);
+            hull->pitchRate += pitching/(points*pitchInertia);
+            hull->rollRate += rolling/(points*rollInertia);
+            hull->heave += hull->heaveRate;
+            hull->pitch += hull->pitchRate;
+            hull->roll += hull->rollRate;
+            if(fabsf(hull->pitch) > maxTilt)
+            {
+                hull->pitch = Clamp(hull->pitch, -maxTilt, maxTilt);
+                hull->pitchRate = 0;
+            }
+            if(fabsf(hull->roll) > maxTilt)
+            {
+                hull->roll = Clamp(hull->roll, -maxTilt, maxTilt);
+                hull->rollRate = 0;
+            }
+        }
+    }
+
+    const HullMotion& result(int hull)
+    {
+        return motion[hull];
+    }
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "raylib.h"
+#include "raymath.h"
+#include "buoyancy.hpp"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define DEBRIS_SSE2 1
+#endif
+
+// Wreckage of sunk ships. The deck, cannons and railing are cut ahead of time
+// into cells (bands along the keel, port and starboard), and a wreck throws
+// one rigid piece per cell from where it sat on the hull. Pieces fall, float
+// on the same sea the hulls ride, lose their buoyancy as they soak and sink
+// out of sight. They are kept as structure-of-arrays in a fixed ring: every
+// piece lives equally long, so the ring is always ordered oldest first;
+// expiry pops the front, and a full ring hands its oldest pieces out again
+// instead of allocating. One tick is a batched sea sample and a single 4-wide
+// pass over every piece. Like particles, wrecks draw from their own random
+// sequence, so they never shift gameplay.
+
+//the parts a wreck breaks into, in the order the renderer loads their models
+enum DebrisPart {DEBRIS_DECK, DEBRIS_CANNONS, DEBRIS_RAILING, debrisPartCount};
+
+//cells in the parts' model space (allShip.obj's): cell = band*2 + side,
+//bands run from the stern along z and side 1 is x >= 0
+const int debrisBands = 4;
+const float debrisKeelStart = -12.6f;
+const float debrisKeelEnd = 8.8f;
+const float debrisSideOffset = 1.6f;        //a cell's pivot from the middle line, about half the deck's half beam
+inline const float debrisPartHeight[debrisPartCount] = {-1.45f, 0.06f, 0.77f};   //middle of each part's height
+
+inline int debrisCell(float x, float z)
+{
+    int band = (int)((z - debrisKeelStart)/(debrisKeelEnd - debrisKeelStart)*debrisBands);
+    if(band < 0) {band = 0;}
+    if(band >= debrisBands) {band = debrisBands - 1;}
+    return band*2 + (x >= 0 ? 1 : 0);
+}
+
+struct DebrisPiece
+{
+    int part;
+    int cell;
+};
+
+//the cells each part actually reaches: the deck stops short of the bow and
+//the cannons are one row across the beam
+inline const DebrisPiece debrisPieces[] = {
+    {DEBRIS_DECK, 0}, {DEBRIS_DECK, 1}, {DEBRIS_DECK, 2}, {DEBRIS_DECK, 3}, {DEBRIS_DECK, 4}, {DEBRIS_DECK, 5},
+    {DEBRIS_CANNONS, 2}, {DEBRIS_CANNONS, 3},
+    {DEBRIS_RAILING, 0}, {DEBRIS_RAILING, 1}, {DEBRIS_RAILING, 2}, {DEBRIS_RAILING, 3},
+    {DEBRIS_RAILING, 4}, {DEBRIS_RAILING, 5}, {DEBRIS_RAILING, 6}, {DEBRIS_RAILING, 7},
+};
+const int debrisPieceCount = sizeof(debrisPieces)/sizeof(debrisPieces[0]);
+
+//where a piece pivots, in model space; its mesh is cut around this point
+inline Vector3 debrisPivot(int piece)
+{
+    const DebrisPiece& p = debrisPieces[piece];
+    const float bandLength = (debrisKeelEnd - debrisKeelStart)/debrisBands;
+    return {(p.cell%2 ? 1 : -1)*debrisSideOffset, debrisPartHeight[p.part], debrisKeelStart + (p.cell/2 + 0.5f)*bandLength};
+}
+
+struct DebrisPose
+{
+    int piece;          //into debrisPieces
+    Vector3 prevPosition;
+    Vector3 position;
+    Quaternion prevRotation;
+    Quaternion rotation;
+    float scale;        //of the ship it came from
+};
+
+class DebrisPool
+{
+    private:
+    static constexpr float gravity = 0.006f;
+    static constexpr float halfDepth = 0.2f;       //a piece is fully under at this far below the surface
+    static constexpr float floatiness = 2.0f;      //buoyancy over weight when fresh; soaks down to 0 over its life
+    static constexpr float airDrag = 0.01f;
+    static constexpr float waterDrag = 0.08f;
+    static constexpr float airSpinDrag = 0.005f;
+    static constexpr float waterSpinDrag = 0.06f;
+    static constexpr float hiddenDepth = 2.0f;     //sunk this far it isn't drawn any more
+    static const int life = 480;
+
+    std::vector<float> x, y, z;
+    std::vector<float> prevX, prevY, prevZ;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> prevQx, prevQy, prevQz, prevQw;
+    std::vector<float> wx, wy, wz;          //spin, radians per tick about each world axis
+    std::vector<float> age;
+    std::vector<float> scale;
+    std::vector<int> piece;
+    std::vector<float> water;               //surface under each piece, sampled every other tick, not saved
+    int capacity;
+    int head;           //oldest piece
+    int count;
+    uint32_t randomState;
+
+    float random(float min, float max)
+    {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return min + (max - min)*(randomState & 0xFFFFFF)/(float)0xFFFFFF;
+    }
+
+    //a full ring overwrites its oldest piece
+    int take()
+    {
+        if(count < capacity) {return (head + count++)%capacity;}
+        const int i = head;
+        head = (head + 1)%capacity;
+        return i;
+    }
+
+    //pieces [first, last) of the ring's storage, one tick on
+    void integrate(int first, int last)
+    {
+        //raw pointers: the default build doesn't inline vector indexing
+        float* x = this->x.data();
+        float* y = this->y.data();
+        float* z = this->z.data();
+        float* prevX = this->prevX.data();
+        float* prevY = this->prevY.data();
+        float* prevZ = this->prevZ.data();
+        float* vx = this->vx.data();
+        float* vy = this->vy.data();
+        float* vz = this->vz.data();
+        float* qx = this->qx.data();
+        float* qy = this->qy.data();
+        float* qz = this->qz.data();
+        float* qw = this->qw.data();
+        float* prevQx = this->prevQx.data();
+        float* prevQy = this->prevQy.data();
+        float* prevQz = this->prevQz.data();
+        float* prevQw = this->prevQw.data();
+        float* wx = this->wx.data();
+        float* wy = this->wy.data();
+        float* wz = this->wz.data();
+        float* age = this->age.data();
+        const float* water = this->water.data();
+        int i = first;
+
+#if defined(DEBRIS_SSE2)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 fall = _mm_set1_ps(gravity);
+        const __m128 depthScale = _mm_set1_ps(0.5f/halfDepth);
+        const __m128 lift = _mm_set1_ps(gravity*floatiness);
+        const __m128 soak = _mm_set1_ps(1.0f/life);
+        const __m128 keepAir = _mm_set1_ps(1 - airDrag);
+        const __m128 dragWater = _mm_set1_ps(waterDrag);
+        const __m128 spinAir = _mm_set1_ps(1 - airSpinDrag);
+        const __m128 spinWater = _mm_set1_ps(waterSpinDrag);
+        for(; i + 4 <= last; i += 4)
+        {
+            const __m128 py = _mm_loadu_ps(y + i);
+            const __m128 years = _mm_loadu_ps(age + i);
+            __m128 under = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(water + i), py), depthScale), half);
+            under = _mm_min_ps(_mm_max_ps(under, zero), one);
+
+            const __m128 buoyancy = _mm_mul_ps(_mm_mul_ps(lift, _mm_sub_ps(one, _mm_mul_ps(years, soak))), under);
+            const __m128 keep = _mm_sub_ps(keepAir, _mm_mul_ps(dragWater, under));
+            const __m128 velX = _mm_mul_ps(_mm_loadu_ps(vx + i), keep);
+            const __m128 velY = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(vy + i), buoyancy), fall), keep);
+            const __m128 velZ = _mm_mul_ps(_mm_loadu_ps(vz + i), keep);
+            const __m128 px = _mm_loadu_ps(x + i);
+            const __m128 pz = _mm_loadu_ps(z + i);
+            _mm_storeu_ps(prevX + i, px);
+            _mm_storeu_ps(prevY + i, py);
+            _mm_storeu_ps(prevZ + i, pz);
+            _mm_storeu_ps(vx + i, velX);
+            _mm_storeu_ps(vy + i, velY);
+            _mm_storeu_ps(vz + i, velZ);
+            _mm_storeu_ps(x + i, _mm_add_ps(px, velX));
+            _mm_storeu_ps(y + i, _mm_add_ps(py, velY));
+            _mm_storeu_ps(z + i, _mm_add_ps(pz, velZ));
+
+            const __m128 spinKeep = _mm_sub_ps(spinAir, _mm_mul_ps(spinWater, under));
+            const __m128 spinX = _mm_mul_ps(_mm_loadu_ps(wx + i), spinKeep);
+            const __m128 spinY = _mm_mul_ps(_mm_loadu_ps(wy + i), spinKeep);
+            const __m128 spinZ = _mm_mul_ps(_mm_loadu_ps(wz + i), spinKeep);
+            _mm_storeu_ps(wx + i, spinX);
+            _mm_storeu_ps(wy + i, spinY);
+            _mm_storeu_ps(wz + i, spinZ);
+
+            //q += (spin*q)/2, renormalised
+            const __m128 ax = _mm_loadu_ps(qx + i);
+            const __m128 ay = _mm_loadu_ps(qy + i);
+            const __m128 az = _mm_loadu_ps(qz + i);
+            const __m128 aw = _mm_loadu_ps(qw + i);
+            _mm_storeu_ps(prevQx + i, ax);
+            _mm_storeu_ps(prevQy + i, ay);
+            _mm_storeu_ps(prevQz + i, az);
+            _mm_storeu_ps(prevQw + i, aw);
+            __m128 bx = _mm_add_ps(ax, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(spinX, aw), _mm_mul_ps(spinY, az)), _mm_mul_ps(spinZ, ay))));
+            __m128 by = _mm_add_ps(ay, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(spinY, aw), _mm_mul_ps(spinZ, ax)), _mm_mul_ps(spinX, az))));
+            __m128 bz = _mm_add_ps(az, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(spinZ, aw), _mm_mul_ps(spinX, ay)), _mm_mul_ps(spinY, ax))));
+            __m128 bw = _mm_sub_ps(aw, _mm_mul_ps(half, _mm_add_ps(_mm_add_ps(_mm_mul_ps(spinX, ax), _mm_mul_ps(spinY, ay)), _mm_mul_ps(spinZ, az))));
+            const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by)), _mm_add_ps(_mm_mul_ps(bz, bz), _mm_mul_ps(bw, bw))));
+            _mm_storeu_ps(qx + i, _mm_div_ps(bx, length));
+            _mm_storeu_ps(qy + i, _mm_div_ps(by, length));
+            _mm_storeu_ps(qz + i, _mm_div_ps(bz, length));
+            _mm_storeu_ps(qw + i, _mm_div_ps(bw, length));
+
+            _mm_storeu_ps(age + i, _mm_add_ps(years, one));
+        }
+#endif
+
+        for(; i < last; i++)
+        {
+            float under = (water[i] - y[i])*(0.5f/halfDepth) + 0.5f;
+            under = fminf(fmaxf(under, 0), 1);
+
+            const float buoyancy = gravity*floatiness*(1 - age[i]*(1.0f/life))*under;
+            const float keep = (1 - airDrag) - waterDrag*under;
+            vx[i] *= keep;
+            vy[i] = ((vy[i] + buoyancy) - gravity)*keep;
+            vz[i] *= keep;
+            prevX[i] = x[i];
+            prevY[i] = y[i];
+            prevZ[i] = z[i];
+            x[i] += vx[i];
+            y[i] += vy[i];
+            z[i] += vz[i];
+
+            const float spinKeep = (1 - airSpinDrag) - waterSpinDrag*under;
+            wx[i] *= spinKeep;
+            wy[i] *= spinKeep;
+            wz[i] *= spinKeep;
+
+            const float ax = qx[i], ay = qy[i], az = qz[i], aw = qw[i];
+            prevQx[i] = ax;
+            prevQy[i] = ay;
+            prevQz[i] = az;
+            prevQw[i] = aw;
+            const float bx = ax + 0.5f*((wx[i]*aw + wy[i]*az) - wz[i]*ay);
+            const float by = ay + 0.5f*((wy[i]*aw + wz[i]*ax) - wx[i]*az);
+            const float bz = az + 0.5f*((wz[i]*aw + wx[i]*ay) - wy[i]*ax);
+            const float bw = aw - 0.5f*((wx[i]*ax + wy[i]*ay) + wz[i]*az);
+            const float length = sqrtf((bx*bx + by*by) + (bz*bz + bw*bw));
+            qx[i] = bx/length;
+            qy[i] = by/length;
+            qz[i] = bz/length;
+            qw[i] = bw/length;
+
+            age[i] += 1;
+        }
+    }
+
+    public:
+    DebrisPool(int maxPieces) : capacity(maxPieces), head(0), count(0), randomState(0x2545F491u)
+    {
+        for(std::vector<float>* field : {&x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &qx, &qy, &qz, &qw,
+                                         &prevQx, &prevQy, &prevQz, &prevQw, &wx, &wy, &wz, &age, &scale, &water})
+        {
+            field->assign(capacity, 0);
+        }
+        piece.assign(capacity, 0);
+    }
+
+    //breaks a ship into every piece in debrisPieces, each starting where it
+    //sat on the hull: origin and rotation place the model as drawn, velocity
+    //is the ship's per tick. pieces are thrown up and away from the middle
+    void shipwreck(Vector3 origin, Matrix rotation, float shipScale, Vector3 velocity)
+    {
+        const Quaternion orientation = QuaternionFromMatrix(rotation);
+        for(int p = 0; p < debrisPieceCount; p++)
+        {
+            const Vector3 offset = Vector3Transform(Vector3Scale(debrisPivot(p), shipScale), rotation);
+            const float spread = random(0.02f, 0.06f);
+            const float across = sqrtf(offset.x*offset.x + offset.z*offset.z) + 0.001f;
+
+            const int i = take();
+            x[i] = prevX[i] = origin.x + offset.x;
+            y[i] = prevY[i] = origin.y + offset.y;
+            z[i] = prevZ[i] = origin.z + offset.z;
+            vx[i] = velocity.x + spread*offset.x/across + random(-0.01f, 0.01f);
+            vy[i] = velocity.y + random(0.06f, 0.14f);
+            vz[i] = velocity.z + spread*offset.z/across + random(-0.01f, 0.01f);
+            qx[i] = prevQx[i] = orientation.x;
+            qy[i] = prevQy[i] = orientation.y;
+            qz[i] = prevQz[i] = orientation.z;
+            qw[i] = prevQw[i] = orientation.w;
+            wx[i] = random(-0.08f, 0.08f);
+            wy[i] = random(-0.04f, 0.04f);
+            wz[i] = random(-0.08f, 0.08f);
+            age[i] = 0;
+            scale[i] = shipScale;
+            piece[i] = p;
+        }
+    }
+
+    //one tick: integrate, then drop what expired. the shortest wave takes
+    //130 ticks, so the surface sampled a tick ago is as good as this one's;
+    //a piece spawned in between starts well above either
+    void update(unsigned long long int tick)
+    {
+        const int firstRun = count < capacity - head ? count : capacity - head;
+        if(tick%2 == 0)
+        {
+            sampleSea(tick, &x[head], &z[head], &water[head], firstRun);
+            sampleSea(tick, x.data(), z.data(), water.data(), count - firstRun);
+        }
+        integrate(head, head + firstRun);
+        integrate(0, count - firstRun);
+
+        while(count > 0 && age[head] >= life)
+        {
+            head = (head + 1)%capacity;
+            count--;
+        }
+    }
+
+    //pieces still above hiddenDepth, oldest first
+    void snapshot(std::vector<DebrisPose>& poses)
+    {
+        for(int n = 0; n < count; n++)
+        {
+            const int i = (head + n)%capacity;
+            if(y[i] < water[i] - hiddenDepth) {continue;}
+            poses.push_back({piece[i], {prevX[i], prevY[i], prevZ[i]}, {x[i], y[i], z[i]},
+                             {prevQx[i], prevQy[i], prevQz[i], prevQw[i]}, {qx[i], qy[i], qz[i], qw[i]}, scale[i]});
+        }
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    //every per-piece array in a fixed order, for world saves: visit(data, n)
+    //gets the live pieces oldest first, in at most two runs per array, as
+    //float* for the numbers and int* for the piece kinds
+    template<typename Visit>
+    void forEachRun(Visit visit)
+    {
+        const int firstRun = count < capacity - head ? count : capacity - head;
+        auto runs = [&](auto& field)
+        {
+            visit(field.data() + head, firstRun);
+            if(count > firstRun) {visit(field.data(), count - firstRun);}
+        };
+        for(std::vector<float>* field : {&x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &qx, &qy, &qz, &qw,
+                                         &prevQx, &prevQy, &prevQz, &prevQw, &wx, &wy, &wz, &age, &scale})
+        {
+            runs(*field);
+        }
+        runs(piece);
+    }
+
+    static const int bytesPerPiece = 22*sizeof(float) + sizeof(int);
+
+    //live count for a restore that is about to fill the runs back in
+    void resize(int n)
+    {
+        head = 0;
+        count = n < capacity ? n : capacity;
+    }
+
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+};
@@ -0,0 +1,2070 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include "raylib.h"
+#include "raymath.h"
+#include "quality.hpp"
+#include "aabbtree.hpp"
+#include "obbset.hpp"
+#include "particles.hpp"
+#include "scheduler.hpp"
+#include "buoyancy.hpp"
+#include "debris.hpp"
+
+// Gameplay: ships, bullets, effects, the ocean and the camera rig, plus
+// the tick that advances them. Only raylib's types and raymath are used, no
+// window, input or GPU calls, so the same code runs in the game, in the
+// --bench harness and in the kapal_sim batch runner.
+
+const int tickRate = 60;        //simulation ticks per second, independent of rendering
+const double tickDt = 1.0/tickRate;
+const float GRAVITY = 0.098f;
+
+inline unsigned long long int tickCounter = 0;
+inline int simTrailInterval = qualityTiers[QUALITY_HIGH].trailInterval;   //owned by whichever thread is simulating
+
+//game-owned xorshift RNG: matches replay from a seed, and the whole state is one word
+inline uint32_t randomState = 0x13C0;
+
+inline void seedGameRandom(uint32_t seed)
+{
+    randomState = seed ? seed : 0x13C0;
+}
+
+//same contract as GetRandomValue: inclusive range, bounds in either order
+inline int gameRandom(int min, int max)
+{
+    if(min > max) {std::swap(min, max);}
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return min + (int)(randomState%((uint32_t)(max - min) + 1));
+}
+
+class Kapal;
+class MKapal;
+class EKapal;
+class Ocean;
+class Bullet;
+
+//the hull in a ship's own frame (x across the beam, z along the keel), from
+//allShip.obj's bounds at the ship scale of 0.25. the height is the old
+//hitbox's, the mesh ends at the waterline
+const Vector3 shipHullOffset = {0, 0, -0.795f};
+const Vector3 shipHullHalf = {1.22f, 1.5f, 2.345f};
+
+struct ShipHitbox
+{
+    BoundingBox ship;   //world-aligned box around the hull, for the tree and separation
+    Vector3 centre;     //the hull itself: an oriented box turned by the heading
+    float cosHeading;
+    float sinHeading;
+    float* health;
+    Kapal* owner;
+    int proxy;          //leaf in shipTree, -1 while the ship is inactive
+    Vector2 push;       //separation gathered this tick
+};
+inline std::vector<ShipHitbox*> ShipHitboxes;
+inline AABBTree shipTree(0.5f);    //active ships' hitboxes, for neighbour queries
+inline ObbSet shipHulls(shipHullHalf);     //hulls in ShipHitboxes order, refreshed every tick for the bullets
+inline BuoyancySolver hullBuoyancy(shipHullHalf, shipHullOffset);
+const float shipRestHeight = 0.5f;          //a ship's height on still water
+inline std::vector<Vector3> respawnedHulls; //centres of hulls that jumped this tick, sleeping bullets look at them
+inline ParticlePool particles(8192);
+inline DebrisPool debris(2048);             //128 wrecks' worth
+const float shipDrawLift = 1.5f;            //the drawn model's origin above a ship's position
+
+//a bullet reaching a hull. collision only records these; applyHits is the
+//one place they change the world, so bullet updates touch nothing shared
+struct HitEvent
+{
+    int attacker;       //ship slots
+    int victim;
+    float damage;
+    Vector3 point;
+    unsigned long long int tick;
+};
+inline std::vector<std::vector<HitEvent>> hitBuffers(1);   //one per worker updating bullets, applied in worker order
+
+//running totals kept by applyHits, for telemetry
+struct HitStats
+{
+    unsigned long long int landed;      //by the player
+    unsigned long long int taken;       //by the player
+    unsigned long long int enemyOnEnemy;
+    float damageDealt;
+    float damageTaken;
+};
+inline HitStats hitStats;
+
+inline Vector3 normalizeVector3(Vector3 v);
+
+//player input sampled once per rendered frame; edges stay latched until a
+//simulation tick consumes them, so no press is lost or applied twice
+struct InputState
+{
+    bool forward;
+    bool left;
+    bool back;
+    bool right;
+    bool fireRight;
+    bool fireLeft;
+    float zoom;
+};
+
+inline void consumeInputEdges(InputState& input)
+{
+    input.fireRight = false;
+    input.fireLeft = false;
+    input.zoom = 0;
+}
+
+//one simulation tick as the renderer sees it. every pose also carries the
+//previous tick, so a single snapshot is enough to interpolate
+struct ShipPose
+{
+    Vector3 prevPosition;
+    Vector3 position;
+    Quaternion prevRotation;
+    Quaternion rotation;
+    float scale;
+    float health;
+    BoundingBox hitbox;
+    Vector3 hullCentre;
+    float hullCos;
+    float hullSin;
+};
+
+struct BulletPose
+{
+    Vector3 prevPosition;
+    Vector3 position;
+    float radius;
+    int firstTrail;     //range in WorldSnapshot::trails
+    int trailCount;
+};
+
+struct WorldSnapshot
+{
+    double time;        //simClock() when it was published
+    Camera prevCamera;
+    Camera camera;
+    float playerAngle;
+    ShipPose player;
+    std::vector<ShipPose> enemies;      //active ones only
+    std::vector<BulletPose> bullets;
+    std::vector<Vector3> trails;
+    std::vector<ParticlePose> particles;
+    std::vector<DebrisPose> debris;
+    std::vector<Vector3> waves;
+};
+
+//monotonic seconds, safe to read from any thread
+inline double simClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//everything MyCam keeps between ticks
+struct CameraState
+{
+    Camera view;
+    Vector3 prevPosition;
+    Vector3 prevTarget;
+    float shakeDuration;
+    float shakeIntensity;
+    Vector3 shakePos;
+    bool shaking;
+};
+
+//the view angles of the ground scope, measured from straight down: its far
+//and its near edge
+const float scopeFarTan = tan((67.5f)*DEG2RAD);
+const float scopeNearTan = tan((22.5f)*DEG2RAD);
+const float scopeFarCos = cos((67.5f)*DEG2RAD);
+const float scopeNearCos = cos((22.5f)*DEG2RAD);
+
+//clip distances BeginMode3D projects with (rlgl's defaults)
+const float viewNear = 0.01f;
+const float viewFar = 1000.0f;
+
+//a perspective view volume as six inward-facing planes: a point is inside
+//when x*p.x + y*p.y + z*p.z + p.w >= 0 for every plane p
+struct ViewFrustum
+{
+    Vector4 planes[6];
+
+    //planes straight from the rows of projection*view (Gribb and Hartmann)
+    void extract(Matrix view, Matrix projection)
+    {
+        const Matrix m = MatrixMultiply(view, projection);
+        const float rows[4][4] = {{m.m0, m.m4, m.m8, m.m12}, {m.m1, m.m5, m.m9, m.m13}, {m.m2, m.m6, m.m10, m.m14}, {m.m3, m.m7, m.m11, m.m15}};
+        for(int i = 0; i < 6; i++)
+        {
+            const float* row = rows[i/2];
+            const float sign = i%2 == 0 ? 1 : -1;
+            Vector4 plane = {rows[3][0] + sign*row[0], rows[3][1] + sign*row[1], rows[3][2] + sign*row[2], rows[3][3] + sign*row[3]};
+            const float length = sqrtf(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+            planes[i] = {plane.x/length, plane.y/length, plane.z/length, plane.w/length};
+        }
+    }
+
+    void extract(const Camera& camera, float aspect)
+    {
+        extract(MatrixLookAt(camera.position, camera.target, camera.up), MatrixPerspective(camera.fovy*DEG2RAD, aspect, viewNear, viewFar));
+    }
+
+    //false only when the sphere is wholly outside
+    bool sees(Vector3 centre, float radius) const
+    {
+        for(const Vector4& plane : planes)
+        {
+            if(plane.x*centre.x + plane.y*centre.y + plane.z*centre.z + plane.w < -radius) {return false;}
+        }
+        return true;
+    }
+};
+
+class MyCam
+{
+    private:
+    Camera cam;
+    Vector3 prevPosition;   //pose at the start of the current tick, for interpolation
+    Vector3 prevTarget;
+    float shakeDuration;
+    float shakeIntensity;
+    Vector3 shakePos;
+    bool shaking;
+    float aspect;           //viewport width/height, for the ground scope
+
+    //everything derived from the pose is cached against a revision that only
+    //moves when position, target, fov or aspect really change, so a camera at
+    //rest (MENU, SETTING, a ship lying still) costs nothing per tick
+    unsigned long long revision;
+    unsigned long long cachedRevision;
+    Matrix viewMatrix;
+    Matrix projectionMatrix;
+    ViewFrustum frustum;
+    Vector3 ground[4];
+
+    void place(Vector3 position, Vector3 target)
+    {
+        if(position.x == cam.position.x && position.y == cam.position.y && position.z == cam.position.z &&
+           target.x == cam.target.x && target.y == cam.target.y && target.z == cam.target.z) {return;}
+        cam.position = position;
+        cam.target = target;
+        revision++;
+    }
+
+    void refresh()
+    {
+        if(cachedRevision == revision) {return;}
+
+        viewMatrix = MatrixLookAt(cam.position, cam.target, cam.up);
+        projectionMatrix = MatrixPerspective(cam.fovy*DEG2RAD, aspect, viewNear, viewFar);
+        frustum.extract(viewMatrix, projectionMatrix);
+
+        const float xUpperDist = cam.position.y * scopeFarTan;
+        const float xLowerDist = cam.position.y * scopeNearTan;
+        const float upperDist = cam.position.y / scopeFarCos;
+        const float lowerDist = cam.position.y / scopeNearCos;
+        const float spread = tan((cam.fovy * aspect/2)*DEG2RAD);
+        const float zHalfUpperDist = upperDist * spread;
+        const float zHalfLowerDist = lowerDist * spread;
+
+        ground[0] = {cam.position.x + xUpperDist, 0, cam.position.z - zHalfUpperDist};
+        ground[1] = {cam.position.x + xUpperDist, 0, cam.position.z + zHalfUpperDist};
+        ground[2] = {cam.position.x + xLowerDist, 0, cam.position.z + zHalfLowerDist};
+        ground[3] = {cam.position.x + xLowerDist, 0, cam.position.z - zHalfLowerDist};
+
+        cachedRevision = revision;
+    }
+
+    public:
+    MyCam(Vector3 target, float aspectRatio = 16.0f/10.0f)
+    {
+        aspect = aspectRatio;
+        cam = Camera();
+        cam.position = (Vector3){target.x-10.0f, target.y+10.0f, target.z};
+        cam.target = target;
+        cam.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+        cam.fovy = 45.0f;                                // Camera field-of-view Y
+        cam.projection = CAMERA_PERSPECTIVE;             // Camera projection type
+
+        shakeDuration = 0;
+        shakeIntensity = 0;
+        shakePos = cam.position;
+        shaking = false;
+        revision = 1;
+        cachedRevision = 0;
+        snap();
+    }
+
+    void storePrevious()
+    {
+        prevPosition = cam.position;
+        prevTarget = cam.target;
+    }
+
+    //drops interpolation after a teleport
+    void snap()
+    {
+        storePrevious();
+    }
+
+    //camera between the previous and the current tick, alpha in [0, 1]
+    Camera interpolated(float alpha)
+    {
+        Camera view = cam;
+        view.position = Vector3Lerp(prevPosition, cam.position, alpha);
+        view.target = Vector3Lerp(prevTarget, cam.target, alpha);
+        return view;
+    }
+
+    void shake(float duration, float intensity)
+    {
+        if(shakeDuration > 0){return;}
+        shakeDuration = duration;
+        shakeIntensity = intensity;
+        shaking = true;
+        shakePos = cam.position;
+    }
+
+    //one tick of shake: the camera jitters while it lasts, then settles back
+    //where it was hit
+    void updateShake()
+    {
+        if(!shaking) {return;}
+        if(shakeDuration > 0)
+        {
+            Vector3 position = cam.position;
+            position.x += gameRandom(-1, 1)*shakeIntensity;
+            position.y += gameRandom(-1, 1)*shakeIntensity;
+            position.z += gameRandom(-1, 1)*shakeIntensity;
+            place(position, cam.target);
+            shakeDuration -= 1.0f/tickRate;
+        }
+        if(shakeDuration <= 0)
+        {
+            shaking = false;
+            shakeDuration = 0;
+            place(shakePos, cam.target);
+        }
+    }
+
+    float getdist(Vector3 point)
+    {
+        return Vector3Distance(point, cam.position);
+    }
+
+    //the trapezoid of sea in view, far edge first: {far left, far right,
+    //near right, near left}
+    const Vector3* groundScope()
+    {
+        refresh();
+        return ground;
+    }
+
+    const ViewFrustum& getFrustum()
+    {
+        refresh();
+        return frustum;
+    }
+
+    Matrix getViewMatrix()
+    {
+        refresh();
+        return viewMatrix;
+    }
+
+    Matrix getProjectionMatrix()
+    {
+        refresh();
+        return projectionMatrix;
+    }
+
+    //changes whenever the pose does; compare against a stored value to skip
+    //work while the camera is at rest
+    unsigned long long getRevision()
+    {
+        return revision;
+    }
+
+    void setAspect(float aspectRatio)
+    {
+        if(aspectRatio == aspect) {return;}
+        aspect = aspectRatio;
+        revision++;
+    }
+
+    void setTarget(float x, float y, float z)
+    {
+        place(cam.position, (Vector3){x, y, z});
+    }
+
+    bool isShaking()
+    {
+        return shakeDuration > 0;
+    }
+
+    void setPos(float x, float y, float z)
+    {
+        if(shakeDuration > 0){return;}
+        place((Vector3){x, y, z}, cam.target);
+    }
+
+    //same as rcamera's CameraMoveForward/CameraMoveRight: position and target
+    //move together along the view direction, or its ground projection
+    void moveForward(float distance, bool inWorldPlane)
+    {
+        Vector3 forward = Vector3Normalize(Vector3Subtract(cam.target, cam.position));
+        if(inWorldPlane)
+        {
+            forward.y = 0;
+            forward = Vector3Normalize(forward);
+        }
+        forward = Vector3Scale(forward, distance);
+        place(Vector3Add(cam.position, forward), Vector3Add(cam.target, forward));
+    }
+
+    void moveRight(float distance, bool inWorldPlane)
+    {
+        Vector3 forward = Vector3Normalize(Vector3Subtract(cam.target, cam.position));
+        Vector3 right = Vector3CrossProduct(forward, Vector3Normalize(cam.up));
+        if(inWorldPlane) {right.y = 0;}
+        right = Vector3Scale(Vector3Normalize(right), distance);
+        place(Vector3Add(cam.position, right), Vector3Add(cam.target, right));
+    }
+
+    CameraState state()
+    {
+        return {cam, prevPosition, prevTarget, shakeDuration, shakeIntensity, shakePos, shaking};
+    }
+
+    void load(const CameraState& saved)
+    {
+        cam = saved.view;
+        prevPosition = saved.prevPosition;
+        prevTarget = saved.prevTarget;
+        shakeDuration = saved.shakeDuration;
+        shakeIntensity = saved.shakeIntensity;
+        shakePos = saved.shakePos;
+        shaking = saved.shaking;
+        revision++;
+    }
+
+    Vector3 getPos()
+    {
+        return cam.position;
+    }
+
+};
+
+struct OceanState
+{
+    int waveCount;
+    float waveDensity;
+    float waveSpeed;
+    Vector3 scope[4];
+    Vector3 tempScope[4];
+};
+
+class Ocean {
+private:
+    int maxWave;
+    int waveCount;
+    float waveDensity;
+    MyCam* cam;
+    float waveSpeed;
+    std::vector<Vector3> scope;
+    std::vector<Vector3> tempScope;
+    unsigned long long scopeRevision;   //camera revision scope was last taken at
+    std::vector<Vector3*> wavePos;
+
+    void createWave(int wave_count)
+    {
+        for(int i = 0; i < wave_count; i++) {
+            Vector3* temp = new Vector3();
+            temp->x = gameRandom(scope[0].x, scope[2].x);
+            temp->y = 0;
+            temp->z = gameRandom(scope[0].z, scope[1].z);
+            wavePos.push_back(temp);
+            waveCount++;
+        }
+    }
+
+    void createWave(std::vector<Vector3>& oldScope)
+    {
+        int targetWave = waveDensity*(scope[0].x - scope[2].x)*(scope[1].z - scope[0].z);
+        if((oldScope[0].x - oldScope[2].x)*(oldScope[1].z - oldScope[0].z) - (scope[0].x - scope[2].x)*(scope[1].z - scope[0].z) > 1)
+        {
+            while(waveCount > targetWave)
+            {
+                delete wavePos[wavePos.size() - 1];
+                wavePos.pop_back();
+                waveCount--;
+            }
+            return;
+        }
+
+        for(int i = 0; (i <= targetWave - waveCount); i ++)
+        {
+            switch(i%4)
+            {
+                case 0:
+                    createWave("bottom");
+                    break;
+                case 1:
+                    createWave("top");
+                    break;
+                case 2:
+                    createWave("left");
+                    break;
+                case 3:
+                    createWave("right");
+                    break;
+            }
+        }
+    }
+
+    void createWave(const std::string side)
+    {
+        if(side == "bottom")
+        {
+            // std::cout<<"bottom\n";
+            Vector3* temp = new Vector3();
+            temp->x = scope[2].x - gameRandom(1, 4);
+            temp->y = 0;
+            temp->z = gameRandom(scope[0].z, scope[1].z);
+            wavePos.push_back(temp);
+            waveCount++;
+        }
+        else if(side == "top")
+        {
+            // std::cout<<"top\n";
+            Vector3* temp = new Vector3();
+            temp->x = scope[0].x + gameRandom(1, 4);
+            temp->y = 0;
+            temp->z = gameRandom(scope[0].z, scope[1].z);
+            wavePos.push_back(temp);
+            waveCount++;
+        }
+        else if(side == "left")
+        {
+            // std::cout<<"left\n";
+            Vector3* temp = new Vector3();
+            temp->x = gameRandom(scope[2].x, scope[0].x);
+            temp->y = 0;
+            temp->z = scope[0].z + gameRandom(1, 4);
+            wavePos.push_back(temp);
+            waveCount++;
+        }
+        else if(side == "right")
+        {
+            // std::cout<<"right\n";
+            Vector3* temp = new Vector3();
+            temp->x = gameRandom(scope[2].x, scope[0].x);
+            temp->y = 0;
+            temp->z = scope[1].z - gameRandom(1, 4);
+            wavePos.push_back(temp);
+            waveCount++;
+        }
+    }
+
+    //the camera's ground scope, unless it hasn't moved since the last time
+    void takeScope()
+    {
+        if(cam->getRevision() == scopeRevision) {return;}
+        const Vector3* ground = cam->groundScope();
+        for(int i = 0; i < 4; i++) {scope[i] = ground[i];}
+        scopeRevision = cam->getRevision();
+    }
+
+public:
+    Ocean(int max_wave, MyCam* camera , float wave_speed, float wave_density)
+    : maxWave(max_wave), waveSpeed(wave_speed), cam(camera), waveDensity(wave_density) {
+        waveCount = 0;
+        scope = {(Vector3){0, 0, 0}, (Vector3){0, 0, 0}, (Vector3){0, 0, 0}, (Vector3){0, 0, 0}};
+        scopeRevision = 0;
+        takeScope();
+        tempScope = scope;
+        createWave(waveDensity*(scope[0].x - scope[2].x)*(scope[1].z - scope[0].z));
+    }
+
+    void update()
+    {
+        takeScope();
+
+
+        for(int i = 0; i < wavePos.size(); i++)
+        {
+            wavePos[i]->x += waveSpeed;
+
+            if(wavePos[i]->x > scope[0].x + 5) {
+                // std::cout<<"deleting top\n";
+                delete wavePos[i];
+                wavePos.erase(wavePos.begin() + i);
+                if(tempScope[0].x - scope[0].x > 1){createWave("bottom");}
+                i--;
+                continue;
+            }
+            else if (wavePos[i]->x < scope[2].x - 5) {
+                // std::cout<<"deleting bottom\n";
+                delete wavePos[i];
+                wavePos.erase(wavePos.begin() + i);
+                if(tempScope[0].x - scope[0].x > 1){createWave("top");}
+                i--;
+                continue;
+            }
+            
+            if(wavePos[i]->z > scope[1].z + 5) {
+                // std::cout<<"deleting right\n";
+                delete wavePos[i];
+                wavePos.erase(wavePos.begin() + i);
+                createWave("left");
+                i--;
+            }
+            else if (wavePos[i]->z < scope[0].z - 5) {
+                // std::cout<<"deleting left\n";
+                delete wavePos[i];
+                wavePos.erase(wavePos.begin() + i);
+                createWave("right");
+                i--;
+            }
+
+        }
+        waveCount = wavePos.size();
+        createWave(tempScope);
+        tempScope = scope;
+    }
+
+    Vector3 getScope(int index)
+    {
+        return scope[index];
+    }
+
+    void setWaveDensity(float density)
+    {
+        if(density == waveDensity) {return;}
+        waveDensity = density;
+
+        int targetWave = waveDensity*(scope[0].x - scope[2].x)*(scope[1].z - scope[0].z);
+        if(waveCount < targetWave)
+        {
+            createWave(targetWave - waveCount);
+        }
+        while(waveCount > targetWave && !wavePos.empty())
+        {
+            delete wavePos.back();
+            wavePos.pop_back();
+            waveCount--;
+        }
+    }
+
+    OceanState state()
+    {
+        OceanState saved = {waveCount, waveDensity, waveSpeed};
+        for(int i = 0; i < 4; i++)
+        {
+            saved.scope[i] = scope[i];
+            saved.tempScope[i] = tempScope[i];
+        }
+        return saved;
+    }
+
+    //waves holds saved.waveCount positions
+    void load(const OceanState& saved, const Vector3* waves)
+    {
+        waveDensity = saved.waveDensity;
+        waveSpeed = saved.waveSpeed;
+        for(int i = 0; i < 4; i++)
+        {
+            scope[i] = saved.scope[i];
+            tempScope[i] = saved.tempScope[i];
+        }
+        scopeRevision = 0;
+
+        while(wavePos.size() > saved.waveCount)
+        {
+            delete wavePos.back();
+            wavePos.pop_back();
+        }
+        while(wavePos.size() < saved.waveCount) {wavePos.push_back(new Vector3());}
+        for(int i = 0; i < saved.waveCount; i++) {*wavePos[i] = waves[i];}
+        waveCount = saved.waveCount;
+    }
+
+    Vector3 getWave(int index)
+    {
+        return *wavePos[index];
+    }
+
+    void copyWaves(std::vector<Vector3>& out)
+    {
+        out.clear();
+        for(int i = 0; i < waveCount; i++) {
+            out.push_back(*wavePos[i]);
+        }
+    }
+
+    ~Ocean() {
+        while(!wavePos.empty())
+        {
+            delete wavePos.back();
+            wavePos.pop_back();
+        }
+    }
+};
+
+//the plain-data part of each entity lives in a base struct, so a world save
+//copies it in one block (see WorldSave)
+struct BulletState
+{
+    Vector3 origin;                 //where it left the gun
+    Vector3 velocity;               //per tick, before gravity
+    unsigned long long int launchTick;  //tick of its first update
+    unsigned long long int nextCheck;   //first tick it could touch a hull
+    int impactUpdate;               //the update that takes it under the water
+    float maxStep;                  //furthest it moves in one tick
+    float damage;
+    bool isAlive;
+    float radius;
+};
+
+//a shot is its launch parameters: where it is after k updates is a closed
+//form, so the tick only pays for the shots that are close to a hull. the
+//water impact is solved for once, at launch
+class Bullet : protected BulletState
+{
+    private:
+    Kapal* owner;
+
+    //after k updates: the same steps the per-tick integration took, each
+    //update falls g further than the last
+    Vector3 positionAt(int k)
+    {
+        const float g = GRAVITY/tickRate;
+        return {origin.x + k*velocity.x, origin.y + k*velocity.y - g*k*(k - 1)/2, origin.z + k*velocity.z};
+    }
+
+    public:
+    Bullet(Vector3 pos, Vector3 directionVec, Kapal* shooter, float speed = 0.3, float dmg = 10, float radius = 0.25)
+    {
+        const Vector3 direction = normalizeVector3(directionVec);
+        this->origin = pos;
+        this->velocity = {direction.x*speed, directionVec.y, direction.z*speed};
+        this->launchTick = tickCounter;
+        this->nextCheck = 0;
+        this->damage = dmg;
+        this->isAlive = true;
+        this->owner = shooter;
+        this->radius = radius;
+
+        //first update below y = -1: the larger root of the height parabola,
+        //then nudged onto the exact integer the float steps give
+        const float g = GRAVITY/tickRate;
+        const float b = velocity.y + g/2;
+        int k = (int)((b + sqrt(fmax(b*b + 2*g*(origin.y + 1), 0.0f)))/g) + 1;
+        while(k > 1 && positionAt(k - 1).y < -1) {k--;}
+        while(positionAt(k).y >= -1) {k++;}
+        this->impactUpdate = k;
+
+        const float fall = fmax(fabs(velocity.y), fabs(velocity.y - g*(k - 1)));
+        this->maxStep = sqrt(velocity.x*velocity.x + velocity.z*velocity.z) + fall;
+    }
+    ~Bullet() {}
+
+    void update(std::vector<HitEvent>& hits);
+
+    //trail points are where it was on every trail tick since launch
+    void snapshot(std::vector<BulletPose>& poses, std::vector<Vector3>& trailPoints)
+    {
+        const int k = tickCounter - launchTick;
+        const int firstTrail = trailPoints.size();
+        unsigned long long int tick = (launchTick + simTrailInterval - 1)/simTrailInterval*simTrailInterval;
+        for(; tick < tickCounter; tick += simTrailInterval)
+        {
+            trailPoints.push_back(positionAt(tick - launchTick));
+        }
+        poses.push_back({positionAt(k - 1), positionAt(k), radius, firstTrail, (int)trailPoints.size() - firstTrail});
+    }
+
+    bool alive()
+    {
+        return isAlive;
+    }
+
+    //gone because it reached the water rather than a hull
+    bool inWater()
+    {
+        return tickCounter - launchTick + 1 >= impactUpdate;
+    }
+
+    //on the surface above its last update before it went under
+    Vector3 splashPoint()
+    {
+        const Vector3 last = positionAt(impactUpdate - 1);
+        return {last.x, 0, last.z};
+    }
+
+    void kill()
+    {
+        isAlive = false;
+    }
+
+    Vector3 getPos()
+    {
+        return positionAt(tickCounter - launchTick);
+    }
+
+    const BulletState& state()
+    {
+        return *this;
+    }
+
+    Kapal* getOwner()
+    {
+        return owner;
+    }
+
+    void load(const BulletState& saved, Kapal* shooter)
+    {
+        (BulletState&)*this = saved;
+        owner = shooter;
+        nextCheck = 0;
+    }
+
+};
+inline std::vector<Bullet*> Bullets;
+
+struct KapalState
+{
+    Matrix transform;           //hull orientation; the renderer owns the mesh
+
+    float scale;
+    float health;
+
+    Vector3 position;
+    Vector3 prevPosition;       //pose at the start of the current tick, for interpolation
+    Quaternion prevRotation;
+    Vector3 localAxis[3];
+    float angle;
+    HullMotion buoyancy;        //riding the sea, solved by hullBuoyancy
+    float tempRoll;
+    float throttle;
+
+    int cooldown;
+    int cooldownTimer_R;
+    int cooldownTimer_L;
+
+    float angleToFace;          //EKapal only
+    bool active;                //EKapal only, the player is always active
+    int aiPhase;                //EKapal only: where its behaviour is, see EKapal::behaviour
+    unsigned long long int aiWake;  //EKapal only: the tick its behaviour decides again
+    InputState aiIntent;        //EKapal only: what it holds until then
+};
+
+class Kapal : protected KapalState
+{
+    private:
+
+    protected:
+    ShipHitbox hitboxes;
+    int slot;                   //0 for the player, enemy index + 1 otherwise
+    int hullIndex;              //in this tick's hullBuoyancy batch
+
+    // virtual void draw() {DrawCube(position, 1.0f, 2.0f, 2.0f, RED);}
+
+
+    void determineLocalAxis()
+    {
+        localAxis[0] = normalizeVector3((Vector3){position.x*sin((angle)*DEG2RAD), 0, position.z*cos((angle)*DEG2RAD)});
+        localAxis[1] = (Vector3){0, 1, 0};
+        localAxis[2] = normalizeVector3(Vector3CrossProduct(localAxis[0], localAxis[1]));
+
+        if(angle < 0)
+        {
+            angle = 360 + angle;
+        }
+        if(angle >= 360)
+        {
+            angle -= 360;
+        }
+    }
+
+    public:
+    Kapal(Vector3 pos)
+    {
+        position = pos;
+        slot = 0;
+        hullIndex = 0;
+        angleToFace = 0;
+        active = true;
+        aiPhase = 0;
+        aiWake = 0;
+        aiIntent = {};
+        cooldown = 60;
+        cooldownTimer_R = 0;
+        cooldownTimer_L = 0;
+        transform = MatrixIdentity();
+        health = 50;
+        hitboxes.proxy = -1;
+        snap();
+    }
+
+    void storePrevious()
+    {
+        prevPosition = position;
+        prevRotation = QuaternionFromMatrix(transform);
+    }
+
+    //drops interpolation after a teleport
+    void snap()
+    {
+        storePrevious();
+    }
+
+    float getHealth()
+    {
+        return health;
+    }
+
+    Vector3 getLocalAxis(int index)
+    {
+        return localAxis[index];
+    }
+
+    void shoot(bool right, Vector3 direction)
+    {
+        if(right && cooldownTimer_R > 0) {return;}
+        else if(!right && cooldownTimer_L > 0) {return;}
+
+        if(right) {cooldownTimer_R = cooldown;}
+        else {cooldownTimer_L = cooldown;}
+
+        Vector3 bulletPos = position;
+        bulletPos.y += 0.5;
+        bulletPos.z -= 1.5*cos((angle)*DEG2RAD);
+        bulletPos.x -= 1.5*sin((angle)*DEG2RAD);
+
+        // Vector3 bulletDir;
+        // bulletDir.x = sin((angle - 90)*DEG2RAD);
+        // bulletDir.z = cos((angle - 90)*DEG2RAD);
+        // bulletDir.y = sin(tempRoll*DEG2RAD);
+
+        // if(!right)
+        // {
+        //     bulletDir.x *= -1;
+        //     bulletDir.y *= -1;
+        //     bulletDir.z *= -1;
+        // }
+
+        Bullet* temp = new Bullet(bulletPos, direction, this);
+        Bullets.push_back(temp);
+        particles.muzzleSmoke(bulletPos, normalizeVector3(direction));
+    }
+
+    void fireBroadside(bool right)
+    {
+        //default bullet direction, perpendicular to the hull
+        const float side = right ? 1 : -1;
+        Vector3 bulletDir;
+        bulletDir.x = side*sin((angle - 90)*DEG2RAD);
+        bulletDir.z = side*cos((angle - 90)*DEG2RAD);
+        bulletDir.y = side*sin(tempRoll*DEG2RAD);
+
+        shoot(right, bulletDir);
+    }
+
+    const KapalState& state()
+    {
+        return *this;
+    }
+
+    const ShipHitbox& getHitbox()
+    {
+        return hitboxes;
+    }
+
+    int getSlot()
+    {
+        return slot;
+    }
+
+    void setSlot(int index)
+    {
+        slot = index;
+    }
+
+    //hitbox is only read for its shape
+    void load(const KapalState& saved, const ShipHitbox& hitbox)
+    {
+        (KapalState&)*this = saved;
+        hitboxes.ship = hitbox.ship;
+        hitboxes.centre = hitbox.centre;
+        hitboxes.cosHeading = hitbox.cosHeading;
+        hitboxes.sinHeading = hitbox.sinHeading;
+        syncTree();
+    }
+
+    //throws the pieces this ship breaks into, from where they sit as drawn
+    void wreck()
+    {
+        debris.shipwreck({position.x, position.y + shipDrawLift, position.z}, transform, scale, Vector3Subtract(position, prevPosition));
+    }
+
+    ShipPose pose()
+    {
+        return {prevPosition, position, prevRotation, QuaternionFromMatrix(transform), scale, health, hitboxes.ship,
+                hitboxes.centre, hitboxes.cosHeading, hitboxes.sinHeading};
+    }
+
+    //the hull from position and heading, then the world-aligned box that just holds it
+    void updateBoundingBox()
+    {
+        const float c = cos(angle*DEG2RAD);
+        const float s = sin(angle*DEG2RAD);
+        hitboxes.cosHeading = c;
+        hitboxes.sinHeading = s;
+        hitboxes.centre.x = position.x + shipHullOffset.x*c + shipHullOffset.z*s;
+        hitboxes.centre.y = position.y + shipHullOffset.y;
+        hitboxes.centre.z = position.z - shipHullOffset.x*s + shipHullOffset.z*c;
+
+        const float extentX = shipHullHalf.x*fabsf(c) + shipHullHalf.z*fabsf(s);
+        const float extentZ = shipHullHalf.x*fabsf(s) + shipHullHalf.z*fabsf(c);
+        hitboxes.ship.min = {hitboxes.centre.x - extentX, hitboxes.centre.y - shipHullHalf.y, hitboxes.centre.z - extentZ};
+        hitboxes.ship.max = {hitboxes.centre.x + extentX, hitboxes.centre.y + shipHullHalf.y, hitboxes.centre.z + extentZ};
+        syncTree();
+    }
+
+    //puts the ship's leaf in shipTree in step with its hitbox; only active ships have one
+    void syncTree()
+    {
+        if(active && hitboxes.proxy < 0) {hitboxes.proxy = shipTree.insert(hitboxes.ship, &hitboxes);}
+        else if(active) {shipTree.move(hitboxes.proxy, hitboxes.ship);}
+        else if(hitboxes.proxy >= 0)
+        {
+            shipTree.remove(hitboxes.proxy);
+            hitboxes.proxy = -1;
+        }
+    }
+
+    //puts the hull in this tick's buoyancy batch
+    void submitHull()
+    {
+        hullIndex = hullBuoyancy.add(position, hitboxes.cosHeading, hitboxes.sinHeading, buoyancy);
+    }
+
+    //takes the solved motion: the hull pitched and rolled on the water, heeled
+    //into its turn and turned to its heading, and the hitbox lifted along
+    void settle()
+    {
+        buoyancy = hullBuoyancy.result(hullIndex);
+        const float lift = shipRestHeight + buoyancy.heave - position.y;
+        position.y += lift;
+        transform = MatrixMultiply(MatrixMultiply(MatrixRotateX(-buoyancy.pitch), MatrixRotateZ(buoyancy.roll - tempRoll*DEG2RAD)), MatrixRotateY(angle*DEG2RAD));
+
+        hitboxes.ship.min.y += lift;
+        hitboxes.ship.max.y += lift;
+        hitboxes.centre.y += lift;
+        syncTree();
+    }
+
+    //shifts the ship sideways without turning it, for separation
+    void nudge(float dx, float dz)
+    {
+        position.x += dx;
+        position.z += dz;
+        hitboxes.ship.min.x += dx;
+        hitboxes.ship.max.x += dx;
+        hitboxes.ship.min.z += dz;
+        hitboxes.ship.max.z += dz;
+        hitboxes.centre.x += dx;
+        hitboxes.centre.z += dz;
+        syncTree();
+    }
+
+    Vector3 getPos()
+    {
+        return position;
+    }
+    
+    virtual MyCam* getCam() {return nullptr;}
+
+    float getAngle()
+    {
+        return angle;
+    }
+};
+
+//most a hull moves in a tick: sailing, the separation push, its corners
+//swinging as it turns, and the bob on the waves
+const float maxHullStep = 0.4f;
+
+//one tick. a shot that isn't due for a check and hasn't reached the water
+//costs a compare, plus a distance to each hull respawned this tick; a check
+//finds the nearest hull other than the shooter's and, when none is touching,
+//sleeps until the soonest tick one could be
+inline void Bullet::update(std::vector<HitEvent>& hits)
+{
+    const int k = tickCounter - launchTick + 1;
+    if(k >= impactUpdate) {isAlive = false; return;}
+    if(tickCounter < nextCheck)
+    {
+        //the sleep was worked out before a respawned hull was there: wake
+        //if the shot could reach the hull's bounding sphere before then
+        bool woken = false;
+        if(!respawnedHulls.empty())
+        {
+            const Vector3 now = positionAt(k - 1);
+            const float reach = (nextCheck - tickCounter)*(maxStep + maxHullStep) + Vector3Length(shipHullHalf) + radius;
+            for(const Vector3& centre : respawnedHulls)
+            {
+                if(Vector3DistanceSqr(now, centre) <= reach*reach) {woken = true; break;}
+            }
+        }
+        if(!woken) {return;}
+    }
+
+    const Vector3 position = positionAt(k);
+    const float nearest2 = shipHulls.nearest2(position, owner->getSlot());
+    if(nearest2 <= radius*radius)
+    {
+        //the first hull it reaches takes the shot
+        shipHulls.overlapSphere(position, radius, [&](int i)
+        {
+            const ShipHitbox* hitbox = ShipHitboxes[i];
+            if(hitbox->owner == nullptr || hitbox->owner == owner) {return false;}
+
+            hits.push_back({owner->getSlot(), i, damage, position, tickCounter});
+            isAlive = false;
+            return true;
+        });
+        nextCheck = tickCounter + 1;
+        return;
+    }
+
+    const float clearance = sqrt(nearest2) - radius;
+    const float sleep = clearance/(maxStep + maxHullStep);
+    nextCheck = tickCounter + (int)fmax(1, fmin(sleep, impactUpdate - k));
+}
+
+//controller policies: each decides what a ship wants to do this tick, and
+//Ship<Controller> turns that into motion with one shared, inlined copy of the
+//physics. a policy provides
+//  InputState intent(KapalState& ship)      what to do this tick
+//  void follow(const KapalState& ship, float speed, const InputState& intent)
+//                                           after the hull moved by speed
+struct PlayerControl
+{
+    MyCam* camera;
+    InputState input;       //set before every move(): keyboard, kapal_sim's autopilot, ...
+
+    InputState intent(KapalState&)
+    {
+        return input;
+    }
+
+    //drags the camera along with the hull, then zooms
+    void follow(const KapalState& ship, float speed, const InputState& intent)
+    {
+        camera->moveForward(speed*sin(ship.angle * DEG2RAD), true);
+        camera->moveRight(speed*cos(ship.angle * DEG2RAD), true);
+        camera->setTarget(ship.position.x, 0, ship.position.z);
+
+        float dist_cam2kapal = Vector3Distance(ship.position, camera->getPos());
+        float zoomMove = intent.zoom;
+
+        if(((dist_cam2kapal > 6 && zoomMove > 0) || (dist_cam2kapal < 100 && zoomMove < 0)) && !camera->isShaking())
+        {
+            camera->moveForward(zoomMove, false);
+        }
+        camera->setTarget(ship.position.x, 0, ship.position.z);
+    }
+};
+
+//where a ship has to steer to reach the target: what the AI used to work out
+//with its own trig every tick
+struct FlowCell
+{
+    unsigned int stamp;         //generation of the last fill, 0 = never
+    float heading;              //degrees, the angleToFace that points at the target
+    float broadside;            //degrees, the heading that puts the target abeam to starboard
+    float distance;
+    Vector2 toTarget;           //unit direction toward the target
+};
+
+//coarse steering field around one target (the player), re-anchored on it every
+//tick. cells are about a ship long, so neighbouring enemies land in the same
+//one; a cell is worked out from its centre the first time a ship samples it in
+//that tick, so ships sharing a cell share the trig and untouched cells cost
+//nothing. ships outside the grid steer exactly
+class FlowField
+{
+    private:
+    static const int size = 32;         //cells per side
+    static inline const float cellSize = 2*shipHullHalf.z;
+
+    std::vector<FlowCell> cells;
+    Kapal* target;
+    Vector3 targetPos;
+    float originX;
+    float originZ;
+    unsigned int generation;
+
+    public:
+    FlowField() : target(nullptr), targetPos({0, 0, 0}), originX(0), originZ(0), generation(0) {}
+
+    static FlowCell exact(Vector3 targetPos, float x, float z)
+    {
+        FlowCell cell;
+        cell.stamp = 0;
+        cell.heading = atan2f(x - targetPos.x, z - targetPos.z)*RAD2DEG + 180;
+        cell.broadside = cell.heading + 90 >= 360 ? cell.heading - 270 : cell.heading + 90;
+        Vector2 toTarget = {targetPos.x - x, targetPos.z - z};
+        cell.distance = sqrtf(toTarget.x*toTarget.x + toTarget.y*toTarget.y);
+        cell.toTarget = cell.distance > 0 ? (Vector2){toTarget.x/cell.distance, toTarget.y/cell.distance} : (Vector2){0, 0};
+        return cell;
+    }
+
+    //call once per tick before any ship samples; the grid is centred on the target
+    void rebuild(Kapal* steerTarget)
+    {
+        if(cells.empty()) {cells.assign(size*size, {});}
+        target = steerTarget;
+        targetPos = target->getPos();
+        originX = floorf(targetPos.x/cellSize)*cellSize - size/2*cellSize;
+        originZ = floorf(targetPos.z/cellSize)*cellSize - size/2*cellSize;
+
+        //bumping the generation drops every cell at once
+        if(++generation == 0)
+        {
+            for(FlowCell& cell : cells) {cell.stamp = 0;}
+            generation = 1;
+        }
+    }
+
+    FlowCell sample(Kapal* steerTarget, Vector3 pos)
+    {
+        const int cx = (int)floorf((pos.x - originX)/cellSize);
+        const int cz = (int)floorf((pos.z - originZ)/cellSize);
+        if(steerTarget != target || cx < 0 || cz < 0 || cx >= size || cz >= size)
+        {
+            return exact(steerTarget->getPos(), pos.x, pos.z);
+        }
+
+        FlowCell& cell = cells[cz*size + cx];
+        if(cell.stamp != generation)
+        {
+            cell = exact(targetPos, originX + (cx + 0.5f)*cellSize, originZ + (cz + 0.5f)*cellSize);
+            cell.stamp = generation;
+        }
+        return cell;
+    }
+
+    void clear()
+    {
+        target = nullptr;
+    }
+};
+inline FlowField enemyFlow;
+
+//an enemy's helm between decisions: EKapal's behaviour sets what the ship
+//wants and every move() replays it, so a ship whose behaviour sleeps only
+//costs its physics
+struct AIControl
+{
+    Kapal* target;
+
+    InputState intent(KapalState& ship)
+    {
+        return ship.aiIntent;
+    }
+
+    void follow(const KapalState&, float, const InputState&) {}
+};
+
+//enemy behaviours, run once per tick before the enemies move
+inline Scheduler enemyBehaviours;
+
+template<typename Controller>
+class Ship : public Kapal
+{
+    protected:
+    Controller controller;
+
+    public:
+    Ship(Vector3 pos, float initAngle, const Controller& control) : Kapal(pos), controller(control)
+    {
+        scale = 0.25f;
+        angle = 90 + initAngle;
+
+        hitboxes.health = &health;
+        updateBoundingBox();
+        hitboxes.owner = this;
+        ShipHitboxes.push_back(&hitboxes);
+
+        throttle = 0;
+        tempRoll = 0;
+
+        buoyancy = {};
+
+        localAxis[0] = {1, 0, 0};
+        localAxis[1] = {0, 1, 0};   
+        localAxis[2] = {0, 0, 1};
+    }
+
+    void move()
+    {
+        const float maxThrottle = 0.075;
+        const float baseSpeed = 0.005;
+        const float maxRoll = 15;
+
+        const InputState intent = controller.intent(*this);
+
+        //movement angle calculation
+        if(intent.forward && throttle <= maxThrottle) {throttle += 0.001;}
+        if(intent.left && tempRoll > -1*maxRoll ) {tempRoll -= (baseSpeed + throttle) * 3;}
+        if(intent.back && throttle > -2*baseSpeed) {throttle -= 0.001;}
+        if(intent.right && tempRoll < maxRoll ) {tempRoll += (baseSpeed + throttle) * 3;}
+        if(tempRoll > maxRoll) {tempRoll = maxRoll;}
+        else if(tempRoll < -1*maxRoll) {tempRoll = -1*maxRoll;}
+        if(tempRoll >= maxRoll/2) {angle -= (baseSpeed + throttle) * 8 * abs(sin(6*tempRoll));}
+        else if(tempRoll <= -1*maxRoll/2) {angle += (baseSpeed + throttle) * 8 * abs(sin(6*tempRoll));}
+
+        position.x += (baseSpeed + throttle) * sin(angle * DEG2RAD);
+        position.z += (baseSpeed + throttle) * cos(angle * DEG2RAD);
+
+        if(tempRoll < 0 && !intent.left) {tempRoll += (baseSpeed + throttle) * 3;}
+        else if(tempRoll > 0 && !intent.right) {tempRoll -= (baseSpeed + throttle) * 3;}
+
+        controller.follow(*this, baseSpeed + throttle, intent);
+        determineLocalAxis();
+
+        //shoot
+        if(intent.fireRight) {fireBroadside(true);}
+        if(intent.fireLeft) {fireBroadside(false);}
+
+        if(cooldownTimer_R > 0) {cooldownTimer_R--;}
+        if(cooldownTimer_L > 0) {cooldownTimer_L--;}
+
+        updateBoundingBox();
+    }
+};
+
+class MKapal final : public Ship<PlayerControl>
+{
+private:
+    std::vector<Kapal*>& enemies;
+
+public:
+    MKapal(Vector3 pos, float initAngle, MyCam* cam, std::vector<Kapal*>& enemiesArray)
+    : Ship<PlayerControl>(pos, initAngle, {cam, {}}), enemies(enemiesArray)
+    {
+    }
+
+    //input for the next move()
+    void setInput(const InputState& state)
+    {
+        controller.input = state;
+    }
+
+    MyCam* getCam() override
+    {
+        return controller.camera;
+    }
+};
+
+class EKapal final : public Ship<AIControl>
+{
+    private:
+    enum Phase {approaching, circling, standingOff};
+
+    static constexpr float attackRange = 20.0f;
+    static constexpr float maxClosing = 0.16f;      //both hulls at full speed, per tick
+    static const int approachNap = 15;              //most ticks an on-course ship goes without looking
+    static const int standOffTicks = 20;
+    static constexpr float angleTolerance = 5;
+
+    TaskId behaviourTask;
+
+    //where the target is, through the shared flow field
+    FlowCell sight()
+    {
+        const FlowCell flow = enemyFlow.sample(controller.target, position);
+        angleToFace = flow.heading;
+        return flow;
+    }
+
+    //cosine of the angle between the starboard axis and the target
+    float bearing(const FlowCell& flow)
+    {
+        return localAxis[2].x*flow.toTarget.x + localAxis[2].z*flow.toTarget.y;
+    }
+
+    void aim(const FlowCell& flow, InputState& movement)
+    {
+        const float cosAim = cosf(10*DEG2RAD);
+        movement.fireRight = bearing(flow) > cosAim;
+        movement.fireLeft = bearing(flow) < -cosAim;
+    }
+
+    //steers for the target; returns how long the helm can be held, which is
+    //only more than a tick for a ship on course that can't reach attack range
+    //before then
+    int approach(const FlowCell& flow)
+    {
+        InputState movement = {};
+        movement.forward = true;
+
+        float angleBetween = angleToFace - angle;
+        if(angleBetween <= 180 && abs(angleBetween) > angleTolerance && angleBetween > 0)
+        {
+            movement.left = true;
+        }
+        else if((angleBetween > 180 || angleBetween < 0) && abs(angleBetween) > angleTolerance)
+        {
+            movement.right = !movement.left;
+        }
+        aim(flow, movement);
+        aiIntent = movement;
+
+        if(movement.left || movement.right || movement.fireRight || movement.fireLeft) {return 1;}
+        const int reach = (int)((flow.distance - attackRange)/maxClosing);
+        return reach < 1 ? 1 : (reach > approachNap ? approachNap : reach);
+    }
+
+    //turns whichever beam is nearer onto the target and fires when it bears
+    void circle(const FlowCell& flow)
+    {
+        const float cosAligned = cosf(5*DEG2RAD);      //broadside already bears
+        InputState movement = {};
+        movement.forward = true;
+
+        //signed turn to the starboard beam heading, folded onto the port one
+        //when that is the shorter way round
+        float toBeam = flow.broadside - angle;
+        if(toBeam > 180) {toBeam -= 360;}
+        else if(toBeam <= -180) {toBeam += 360;}
+        if(toBeam > 90) {toBeam -= 180;}
+        else if(toBeam < -90) {toBeam += 180;}
+
+        const bool aligned = fabsf(bearing(flow)) > cosAligned;
+        if(!aligned && fabsf(toBeam) > angleTolerance)
+        {
+            if(toBeam > 0) {movement.left = true;}
+            else {movement.right = true;}
+        }
+        aim(flow, movement);
+        aiIntent = movement;
+    }
+
+    //a battery that is told to fire and is loaded goes off this tick
+    bool firing()
+    {
+        return (aiIntent.fireRight && cooldownTimer_R <= 0) || (aiIntent.fireLeft && cooldownTimer_L <= 0);
+    }
+
+    Scheduler::WakeAt hold(int ticks)
+    {
+        aiWake = enemyBehaviours.tick() + ticks;
+        return enemyBehaviours.at(aiWake);
+    }
+
+    //closes in on the target, circles it to bring a broadside to bear, fires,
+    //then stands off on a straight course for a while. all it carries from
+    //one decision to the next is aiPhase, aiWake and aiIntent, and every
+    //suspension leads back to the top of the loop, so a restored ship's
+    //behaviour only has to be woken at the saved tick to carry on
+    static Task behaviour(EKapal* ship)
+    {
+        co_await enemyBehaviours.at(ship->aiWake);
+        while(true)
+        {
+            const FlowCell flow = ship->sight();
+            if(ship->aiPhase == approaching)
+            {
+                if(flow.distance < attackRange)
+                {
+                    ship->aiPhase = circling;
+                    continue;
+                }
+                co_await ship->hold(ship->approach(flow));
+            }
+            else if(ship->aiPhase == circling)
+            {
+                if(flow.distance >= attackRange)
+                {
+                    ship->aiPhase = approaching;
+                    continue;
+                }
+                ship->circle(flow);
+                if(ship->firing()) {ship->aiPhase = standingOff;}
+                co_await ship->hold(1);
+            }
+            else
+            {
+                ship->aiIntent = {};
+                ship->aiIntent.forward = true;
+                ship->aiPhase = circling;
+                co_await ship->hold(standOffTicks);
+            }
+        }
+    }
+
+    //replaces whatever the behaviour was doing; an inactive ship has none
+    void restartBehaviour()
+    {
+        enemyBehaviours.cancel(behaviourTask);
+        behaviourTask = {};
+        if(active) {behaviourTask = enemyBehaviours.spawn(behaviour(this));}
+    }
+
+    public:
+    void restart(Vector3 pos)
+    {
+        position = pos;
+        health = 50;
+        snap();
+        updateBoundingBox();
+        respawnedHulls.push_back(hitboxes.centre);
+
+        aiPhase = approaching;
+        aiWake = tickCounter;
+        aiIntent = {};
+        restartBehaviour();
+    }
+
+    bool isActive()
+    {
+        return active;
+    }
+
+    void setActive(bool act, Vector3 pos = {0, 0, 0})
+    {
+        if(act)
+        {
+            active = true;
+            restart(pos);
+        }
+        else
+        {
+            active = false;
+            syncTree();
+            restartBehaviour();
+        }
+    }
+
+    //the behaviour picks up from the saved phase and wake tick
+    void load(const KapalState& saved, const ShipHitbox& hitbox)
+    {
+        Kapal::load(saved, hitbox);
+        if(active && enemyBehaviours.alive(behaviourTask)) {behaviourTask = enemyBehaviours.reschedule(behaviourTask, aiWake);}
+        else {restartBehaviour();}
+    }
+
+    EKapal(Vector3 pos, float initAngle, Kapal* target) : Ship<AIControl>(pos, initAngle, {target})
+    {
+        active = false;
+        behaviourTask = {};
+        syncTree();
+    }
+};
+
+inline Vector3 normalizeVector3(Vector3 v)
+{
+    float length = sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+    return {v.x/length, v.y/length, v.z/length};
+}
+
+inline std::vector<Kapal*> enemyKapals_copy;
+inline std::vector<EKapal*> enemyKapals;
+inline void createEnemyKapal(Vector3 pos, float angle, Kapal* target)
+{
+    EKapal* temp = new EKapal(pos, angle, target);
+    enemyKapals.push_back(temp);
+    temp->setSlot(enemyKapals.size());
+    enemyKapals_copy.push_back(temp);
+}
+
+inline Vector3 getRandomPos(Vector3 center, float radius, bool inside)
+{
+    Vector3 temp;
+    temp.y = 0;
+
+    float r;
+    float theta = gameRandom(0, 360)*DEG2RAD;
+
+    if(inside)
+    {
+        r = gameRandom(0, radius);
+    }
+    else
+    {
+        r = gameRandom(radius, 10);
+    }
+
+    temp.x = center.x + r*sin(theta);
+    temp.z = center.z + r*cos(theta);
+    return temp;
+}
+
+const float shipSeparation = 0.5f;     //gap ships try to keep between their hitboxes
+const float separationEase = 0.1f;     //share of the missing gap closed per tick
+const float maxSeparationPush = 0.25f; //per ship per tick, so crowds spread out instead of jumping
+inline std::vector<ShipHitbox*> separatedShips;    //separateShips scratch
+
+//keeps ships from piling onto each other. overlapping hulls are pushed apart
+//quickly, ships inside each other's gap are eased apart a little every tick.
+//neighbours come from shipTree, so the pass is O(n log n). pushes are summed
+//per ship and applied once at the end, so every ship moves in the tree at most
+//once. the player is never pushed: the other ship takes the whole correction
+inline void separateShips()
+{
+    separatedShips.clear();
+    for(ShipHitbox* box : ShipHitboxes)
+    {
+        if(box->proxy < 0) {continue;}
+        box->push = {0, 0};
+        separatedShips.push_back(box);
+    }
+
+    for(ShipHitbox* box : separatedShips)
+    {
+        BoundingBox range = box->ship;
+        range.min.x -= shipSeparation;
+        range.min.z -= shipSeparation;
+        range.max.x += shipSeparation;
+        range.max.z += shipSeparation;
+        shipTree.query(range, [box](int proxy)
+        {
+            //each pair once
+            if(proxy <= box->proxy) {return;}
+            ShipHitbox* other = (ShipHitbox*)shipTree.getData(proxy);
+
+            const BoundingBox& a = box->ship;
+            const BoundingBox& b = other->ship;
+            const float gapX = fminf(a.max.x, b.max.x) - fmaxf(a.min.x, b.min.x) + shipSeparation;
+            const float gapZ = fminf(a.max.z, b.max.z) - fmaxf(a.min.z, b.min.z) + shipSeparation;
+            if(gapX <= 0 || gapZ <= 0) {return;}
+
+            //apart along whichever axis needs less
+            const bool alongX = gapX < gapZ;
+            const float missing = alongX ? gapX : gapZ;
+            const float overlap = missing - shipSeparation;
+            const float push = overlap > 0 ? overlap + shipSeparation*separationEase : missing*separationEase;
+
+            const float centreA = alongX ? a.min.x + a.max.x : a.min.z + a.max.z;
+            const float centreB = alongX ? b.min.x + b.max.x : b.min.z + b.max.z;
+            const float side = centreA < centreB ? -1 : 1;     //direction a moves in
+
+            const float shareA = box->owner->getSlot() == 0 ? 0 : (other->owner->getSlot() == 0 ? 1 : 0.5f);
+            const float moveA = side*push*shareA;
+            const float moveB = -side*push*(1 - shareA);
+            if(alongX) {box->push.x += moveA; other->push.x += moveB;}
+            else {box->push.y += moveA; other->push.y += moveB;}
+        });
+    }
+
+    for(ShipHitbox* box : separatedShips)
+    {
+        const float length = sqrtf(box->push.x*box->push.x + box->push.y*box->push.y);
+        if(length == 0) {continue;}
+        const float scale = length > maxSeparationPush ? maxSeparationPush/length : 1;
+        box->owner->nudge(box->push.x*scale, box->push.y*scale);
+    }
+}
+
+//the player and every active enemy through the buoyancy solver, as one batch
+inline void floatShips(Kapal& player)
+{
+    hullBuoyancy.begin();
+    player.submitHull();
+    for(EKapal* enemy : enemyKapals)
+    {
+        if(!enemy->isActive()) {break;}
+        enemy->submitHull();
+    }
+
+    hullBuoyancy.solve(tickCounter);
+
+    player.settle();
+    for(EKapal* enemy : enemyKapals)
+    {
+        if(!enemy->isActive()) {break;}
+        enemy->settle();
+    }
+}
+
+//copies every hull into shipHulls for the bullets' batched test. ships move
+//every tick, so a full refresh costs the same as tracking changes; inactive
+//ships can't be hit
+inline void updateShipHulls()
+{
+    shipHulls.resize(ShipHitboxes.size());
+    for(int i = 0; i < ShipHitboxes.size(); i++)
+    {
+        const ShipHitbox* hitbox = ShipHitboxes[i];
+        if(hitbox->proxy < 0) {shipHulls.remove(i);}
+        else {shipHulls.set(i, hitbox->centre, hitbox->cosHeading, hitbox->sinHeading);}
+    }
+}
+
+//the apply stage: merges every worker's hits into health, camera shake and
+//the hit totals, then sinks the enemies they finished (explosion, respawn,
+//one more enemy while below maxEnemy). buffers go in worker order, so the
+//outcome doesn't depend on how bullets were shared out. returns the kills
+inline int applyHits(MKapal& main_kapal, Ocean& ocean, int& activeEnemy, int maxEnemy)
+{
+    for(const std::vector<HitEvent>& buffer : hitBuffers)
+    {
+        for(const HitEvent& hit : buffer)
+        {
+            *(ShipHitboxes[hit.victim]->health) -= hit.damage;
+            if(hit.victim == 0)
+            {
+                main_kapal.getCam()->shake(0.5, 0.5);
+                hitStats.taken++;
+                hitStats.damageTaken += hit.damage;
+            }
+            else if(hit.attacker == 0)
+            {
+                hitStats.landed++;
+                hitStats.damageDealt += hit.damage;
+            }
+            else {hitStats.enemyOnEnemy++;}
+        }
+    }
+
+    //a respawn restores health, so a ship hit twice this tick sinks once
+    int kills = 0;
+    for(std::vector<HitEvent>& buffer : hitBuffers)
+    {
+        for(const HitEvent& hit : buffer)
+        {
+            if(hit.victim == 0) {continue;}
+            EKapal* enemy = enemyKapals[hit.victim - 1];
+            if(enemy->getHealth() > 0) {continue;}
+
+            kills++;
+            particles.explosion(enemy->getPos());
+            enemy->wreck();
+            enemy->restart(getRandomPos(main_kapal.getPos(), Vector3Distance(main_kapal.getPos(), ocean.getScope(1)), false));
+            if(activeEnemy < maxEnemy)
+            {
+                enemyKapals[activeEnemy]->setActive(true, getRandomPos(main_kapal.getPos(), Vector3Distance(main_kapal.getPos(), ocean.getScope(1)), false));
+                activeEnemy++;
+            }
+        }
+        buffer.clear();
+    }
+    return kills;
+}
+
+//one simulation tick (1/tickRate seconds) of GAMEPLAY; returns how many
+//enemy ships were sunk during it
+inline int gameplayUpdate(MKapal& main_kapal, Ocean& ocean, int& activeEnemy, int maxEnemy, const InputState& input)
+{
+    main_kapal.getCam()->storePrevious();
+    main_kapal.storePrevious();
+    main_kapal.setInput(input);
+    main_kapal.move();
+
+    enemyFlow.rebuild(&main_kapal);
+    enemyBehaviours.run(tickCounter);
+    for(int i = 0; i < enemyKapals.size(); i++)
+    {
+        if(!enemyKapals[i]->isActive()) {break;}
+        enemyKapals[i]->storePrevious();
+        enemyKapals[i]->move();
+    }
+    floatShips(main_kapal);
+    separateShips();
+
+    particles.update();
+    debris.update(tickCounter);
+
+    main_kapal.getCam()->updateShake();
+    ocean.update();
+
+    updateShipHulls();
+    int kept = 0;
+    for(int i = 0; i < Bullets.size(); i++)
+    {
+        Bullets[i]->update(hitBuffers[0]);
+        if(Bullets[i]->alive()) {Bullets[kept++] = Bullets[i];}
+        else
+        {
+            if(Bullets[i]->inWater()) {particles.splash(Bullets[i]->splashPoint());}
+            delete Bullets[i];
+        }
+    }
+    Bullets.resize(kept);
+    respawnedHulls.clear();     //applyHits' respawns are for next tick's bullets
+
+    return applyHits(main_kapal, ocean, activeEnemy, maxEnemy);
+}
+
+//quality knobs the simulation reads; applied by the thread that is ticking
+inline void applySimQuality(const QualityTier& tier, Ocean& ocean)
+{
+    simTrailInterval = tier.trailInterval;
+    particles.setDensity(tier.particleDensity);
+    ocean.setWaveDensity(tier.waveDensity);
+}
+
+//copies everything the renderer needs out of the live world; the vectors keep
+//their capacity between ticks, so steady state doesn't allocate
+inline void captureSnapshot(WorldSnapshot& snapshot, MKapal& main_kapal, Ocean& ocean)
+{
+    snapshot.time = simClock();
+    snapshot.prevCamera = main_kapal.getCam()->interpolated(0);
+    snapshot.camera = main_kapal.getCam()->interpolated(1);
+    snapshot.playerAngle = main_kapal.getAngle();
+    snapshot.player = main_kapal.pose();
+
+    snapshot.enemies.clear();
+    for(int i = 0; i < enemyKapals.size() && enemyKapals[i]->isActive(); i++)
+    {
+        snapshot.enemies.push_back(enemyKapals[i]->pose());
+    }
+
+    snapshot.bullets.clear();
+    snapshot.trails.clear();
+    for(int i = 0; i < Bullets.size(); i++)
+    {
+        Bullets[i]->snapshot(snapshot.bullets, snapshot.trails);
+    }
+
+    snapshot.particles.clear();
+    particles.snapshot(snapshot.particles);
+
+    snapshot.debris.clear();
+    debris.snapshot(snapshot.debris);
+
+    ocean.copyWaves(snapshot.waves);
+}
+
+// Whole-world save state for retry and rewind. Every entity copies its plain
+// data block into one contiguous, pointer-free buffer: a header with the
+// counts and globals, then ships, bullets, particles, debris and waves
+// back to back. Duplicating a save is a single memcpy of the buffer, and a
+// restore is one linear pass that loads the blocks back into the live
+// objects, reusing them where the counts match.
+
+struct ShipRecord
+{
+    KapalState state;
+    ShipHitbox hitbox;          //only its shape is restored
+};
+
+struct BulletRecord
+{
+    BulletState state;
+    int owner;          //ship slot
+};
+
+struct WorldHeader
+{
+    unsigned long long int tick;
+    uint32_t randomState;
+    int trailInterval;
+    int activeEnemy;
+    int shipCount;      //the player, then every enemy
+    int bulletCount;
+    int particleCount;
+    int debrisCount;
+    int waveCount;
+    CameraState camera;
+    OceanState ocean;
+};
+
+class WorldSave
+{
+    private:
+    std::vector<unsigned char> bytes;
+
+    template<typename T>
+    void put(size_t& at, const T* values, size_t count)
+    {
+        memcpy(bytes.data() + at, values, sizeof(T)*count);
+        at += sizeof(T)*count;
+    }
+
+    template<typename T>
+    const T* get(size_t& at, size_t count) const
+    {
+        const T* values = (const T*)(bytes.data() + at);
+        at += sizeof(T)*count;
+        return values;
+    }
+
+    public:
+    bool empty() const
+    {
+        return bytes.empty();
+    }
+
+    size_t size() const
+    {
+        return bytes.size();
+    }
+
+    void save(MKapal& player, Ocean& ocean, int activeEnemy)
+    {
+        WorldHeader header = {};
+        header.tick = tickCounter;
+        header.randomState = randomState;
+        header.trailInterval = simTrailInterval;
+        header.activeEnemy = activeEnemy;
+        header.shipCount = enemyKapals.size() + 1;
+        header.bulletCount = Bullets.size();
+        header.particleCount = particles.size();
+        header.debrisCount = debris.size();
+        header.camera = player.getCam()->state();
+        header.ocean = ocean.state();
+        header.waveCount = header.ocean.waveCount;
+
+        //only grows, so a save reused every tick stops allocating
+        bytes.resize(sizeof(WorldHeader) + sizeof(ShipRecord)*header.shipCount + sizeof(BulletRecord)*header.bulletCount +
+                     ParticlePool::bytesPerParticle*header.particleCount + DebrisPool::bytesPerPiece*header.debrisCount +
+                     sizeof(Vector3)*header.waveCount);
+        size_t at = 0;
+        put(at, &header, 1);
+
+        ShipRecord ship = {player.state(), player.getHitbox()};
+        put(at, &ship, 1);
+        for(EKapal* enemy : enemyKapals)
+        {
+            ship = {enemy->state(), enemy->getHitbox()};
+            put(at, &ship, 1);
+        }
+
+        for(Bullet* bullet : Bullets)
+        {
+            BulletRecord record = {bullet->state(), bullet->getOwner()->getSlot()};
+            put(at, &record, 1);
+        }
+
+        particles.forEachField([&](auto* field) {put(at, field, header.particleCount);});
+        debris.forEachRun([&](auto* run, int n) {put(at, run, n);});
+
+        for(int i = 0; i < header.waveCount; i++)
+        {
+            Vector3 wave = ocean.getWave(i);
+            put(at, &wave, 1);
+        }
+    }
+
+    //the ships have to be the same set that was saved; returns false otherwise
+    bool restore(MKapal& player, Ocean& ocean, int& activeEnemy) const
+    {
+        if(bytes.empty()) {return false;}
+
+        size_t at = 0;
+        const WorldHeader& header = *get<WorldHeader>(at, 1);
+        if(header.shipCount != enemyKapals.size() + 1) {return false;}
+
+        tickCounter = header.tick;
+        randomState = header.randomState;
+        simTrailInterval = header.trailInterval;
+        activeEnemy = header.activeEnemy;
+        player.getCam()->load(header.camera);
+
+        const ShipRecord* ships = get<ShipRecord>(at, header.shipCount);
+        player.load(ships[0].state, ships[0].hitbox);
+        for(int i = 0; i < enemyKapals.size(); i++)
+        {
+            enemyKapals[i]->load(ships[i + 1].state, ships[i + 1].hitbox);
+        }
+
+        const BulletRecord* bullets = get<BulletRecord>(at, header.bulletCount);
+        while(Bullets.size() > header.bulletCount)
+        {
+            delete Bullets.back();
+            Bullets.pop_back();
+        }
+        while(Bullets.size() < header.bulletCount) {Bullets.push_back(new Bullet({0, 0, 0}, {0, 0, 1}, nullptr));}
+        for(int i = 0; i < header.bulletCount; i++)
+        {
+            const BulletRecord& record = bullets[i];
+            Kapal* owner = record.owner == 0 ? (Kapal*)&player : (Kapal*)enemyKapals[record.owner - 1];
+            Bullets[i]->load(record.state, owner);
+        }
+
+        particles.resize(header.particleCount);
+        particles.forEachField([&](auto* field)
+        {
+            const size_t size = sizeof(*field)*header.particleCount;
+            memcpy(field, get<char>(at, size), size);
+        });
+
+        debris.resize(header.debrisCount);
+        debris.forEachRun([&](auto* run, int n)
+        {
+            const size_t size = sizeof(*run)*n;
+            memcpy(run, get<char>(at, size), size);
+        });
+
+        ocean.load(header.ocean, get<Vector3>(at, header.waveCount));
+        return true;
+    }
+};
+
+//ring of the most recent saves, for the rewind hotkey
+class WorldHistory
+{
+    private:
+    std::vector<WorldSave> ring;
+    int next;
+    int count;
+
+    public:
+    WorldHistory(int capacity) : ring(capacity), next(0), count(0) {}
+
+    void push(MKapal& player, Ocean& ocean, int activeEnemy)
+    {
+        ring[next].save(player, ocean, activeEnemy);
+        next = (next + 1)%ring.size();
+        if(count < ring.size()) {count++;}
+    }
+
+    //restores the newest save and drops it, so repeated calls step further back
+    bool rewind(MKapal& player, Ocean& ocean, int& activeEnemy)
+    {
+        if(count == 0) {return false;}
+        next = (next + ring.size() - 1)%ring.size();
+        count--;
+        return ring[next].restore(player, ocean, activeEnemy);
+    }
+
+    void clear()
+    {
+        next = 0;
+        count = 0;
+    }
+};
+
+inline void clearWorld()
+{
+    for(int i = 0; i < Bullets.size(); i++) {delete Bullets[i];}
+    Bullets.clear();
+    particles.clear();
+    debris.clear();
+    enemyBehaviours.clear();
+    for(int i = 0; i < enemyKapals.size(); i++) {delete enemyKapals[i];}
+    enemyKapals.clear();
+    enemyKapals_copy.clear();
+    ShipHitboxes.clear();
+    shipTree.clear();
+    shipHulls.resize(0);
+    respawnedHulls.clear();
+    for(std::vector<HitEvent>& buffer : hitBuffers) {buffer.clear();}
+    hitStats = {};
+    enemyFlow.clear();
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include "raylib.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define OBBSET_SSE2 1
+#endif
+
+// Oriented boxes that all have the same size and only turn about the vertical
+// axis (ship hulls), kept as structure-of-arrays so one sphere is tested
+// against several boxes per instruction: 8 with AVX, 4 with SSE2, one at a
+// time on anything else. The arrays are padded with boxes far outside the
+// world, so the kernels never need a tail loop.
+
+class ObbSet
+{
+    private:
+    static const int padding = 8;   //widest kernel
+    static constexpr float faraway = 1e30f;
+
+    std::vector<float> centreX;
+    std::vector<float> centreY;
+    std::vector<float> centreZ;
+    std::vector<float> cosAngle;
+    std::vector<float> sinAngle;
+    Vector3 half;
+    int count;
+
+    public:
+    ObbSet(Vector3 halfExtents) : half(halfExtents), count(0) {}
+
+    //keeps the first boxes, new ones start out of reach
+    void resize(int boxes)
+    {
+        const int padded = (boxes + padding - 1)/padding*padding;
+        centreX.resize(padded, faraway);
+        centreY.resize(padded, faraway);
+        centreZ.resize(padded, faraway);
+        cosAngle.resize(padded, 1);
+        sinAngle.resize(padded, 0);
+        for(int i = boxes; i < padded; i++) {remove(i);}
+        count = boxes;
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    //box i turned by the heading whose cosine and sine are given, the way
+    //MatrixRotateY turns the ship: local +z goes to (sin, cos) in x/z
+    void set(int i, Vector3 centre, float cosHeading, float sinHeading)
+    {
+        centreX[i] = centre.x;
+        centreY[i] = centre.y;
+        centreZ[i] = centre.z;
+        cosAngle[i] = cosHeading;
+        sinAngle[i] = sinHeading;
+    }
+
+    //box i stays in the set but can't be hit
+    void remove(int i)
+    {
+        set(i, {faraway, faraway, faraway}, 1, 0);
+    }
+
+    //calls hit(i) for every box the sphere touches, in index order, until
+    //hit returns true
+    template<typename Hit>
+    void overlapSphere(Vector3 point, float radius, Hit hit)
+    {
+        const float radius2 = radius*radius;
+        int i = 0;
+
+#if defined(__AVX__)
+        {
+            const __m256 px = _mm256_set1_ps(point.x);
+            const __m256 py = _mm256_set1_ps(point.y);
+            const __m256 pz = _mm256_set1_ps(point.z);
+            const __m256 hx = _mm256_set1_ps(half.x);
+            const __m256 hy = _mm256_set1_ps(half.y);
+            const __m256 hz = _mm256_set1_ps(half.z);
+            const __m256 r2 = _mm256_set1_ps(radius2);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            for(; i < count; i += 8)
+            {
+                //sphere centre in the box's frame
+                const __m256 dx = _mm256_sub_ps(px, _mm256_loadu_ps(&centreX[i]));
+                const __m256 dy = _mm256_sub_ps(py, _mm256_loadu_ps(&centreY[i]));
+                const __m256 dz = _mm256_sub_ps(pz, _mm256_loadu_ps(&centreZ[i]));
+                const __m256 c = _mm256_loadu_ps(&cosAngle[i]);
+                const __m256 s = _mm256_loadu_ps(&sinAngle[i]);
+                const __m256 lx = _mm256_sub_ps(_mm256_mul_ps(dx, c), _mm256_mul_ps(dz, s));
+                const __m256 lz = _mm256_add_ps(_mm256_mul_ps(dx, s), _mm256_mul_ps(dz, c));
+
+                //distance outside the box along each axis
+                const __m256 ex = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, lx), hx), zero);
+                const __m256 ey = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, dy), hy), zero);
+                const __m256 ez = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, lz), hz), zero);
+                const __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez));
+
+                int mask = _mm256_movemask_ps(_mm256_cmp_ps(dist2, r2, _CMP_LE_OQ));
+                for(int lane = 0; mask; lane++, mask >>= 1)
+                {
+                    if((mask & 1) && hit(i + lane)) {return;}
+                }
+            }
+        }
+#elif defined(OBBSET_SSE2)
+        {
+            const __m128 px = _mm_set1_ps(point.x);
+            const __m128 py = _mm_set1_ps(point.y);
+            const __m128 pz = _mm_set1_ps(point.z);
+            const __m128 hx = _mm_set1_ps(half.x);
+            const __m128 hy = _mm_set1_ps(half.y);
+            const __m128 hz = _mm_set1_ps(half.z);
+            const __m128 r2 = _mm_set1_ps(radius2);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            for(; i < count; i += 4)
+            {
+                //sphere centre in the box's frame
+                const __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&centreX[i]));
+                const __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(&centreY[i]));
+                const __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&centreZ[i]));
+                const __m128 c = _mm_loadu_ps(&cosAngle[i]);
+                const __m128 s = _mm_loadu_ps(&sinAngle[i]);
+                const __m128 lx = _mm_sub_ps(_mm_mul_ps(dx, c), _mm_mul_ps(dz, s));
+                const __m128 lz = _mm_add_ps(_mm_mul_ps(dx, s), _mm_mul_ps(dz, c));
+
+                //distance outside the box along each axis
+                const __m128 ex = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, lx), hx), zero);
+                const __m128 ey = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, dy), hy), zero);
+                const __m128 ez = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, lz), hz), zero);
+                const __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+
+                int mask = _mm_movemask_ps(_mm_cmple_ps(dist2, r2));
+                for(int lane = 0; mask; lane++, mask >>= 1)
+                {
+                    if((mask & 1) && hit(i + lane)) {return;}
+                }
+            }
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            const float dx = point.x - centreX[i];
+            const float dy = point.y - centreY[i];
+            const float dz = point.z - centreZ[i];
+            const float lx = dx*cosAngle[i] - dz*sinAngle[i];
+            const float lz = dx*sinAngle[i] + dz*cosAngle[i];
+
+            const float ex = fmaxf(fabsf(lx) - half.x, 0);
+            const float ey = fmaxf(fabsf(dy) - half.y, 0);
+            const float ez = fmaxf(fabsf(lz) - half.z, 0);
+            if(ex*ex + ey*ey + ez*ez <= radius2 && hit(i)) {return;}
+        }
+    }
+
+    //squared distance from point to the nearest box other than skip, 0 when
+    //inside one, infinity when there is none
+    float nearest2(Vector3 point, int skip = -1)
+    {
+        //the skipped box is parked out of reach for the scan
+        float parked[5];
+        if(skip >= 0)
+        {
+            parked[0] = centreX[skip];
+            parked[1] = centreY[skip];
+            parked[2] = centreZ[skip];
+            parked[3] = cosAngle[skip];
+            parked[4] = sinAngle[skip];
+            remove(skip);
+        }
+
+        float best = INFINITY;
+        int i = 0;
+
+#if defined(__AVX__)
+        {
+            const __m256 px = _mm256_set1_ps(point.x);
+            const __m256 py = _mm256_set1_ps(point.y);
+            const __m256 pz = _mm256_set1_ps(point.z);
+            const __m256 hx = _mm256_set1_ps(half.x);
+            const __m256 hy = _mm256_set1_ps(half.y);
+            const __m256 hz = _mm256_set1_ps(half.z);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 nearest = _mm256_set1_ps(INFINITY);
+            for(; i < count; i += 8)
+            {
+                const __m256 dx = _mm256_sub_ps(px, _mm256_loadu_ps(&centreX[i]));
+                const __m256 dy = _mm256_sub_ps(py, _mm256_loadu_ps(&centreY[i]));
+                const __m256 dz = _mm256_sub_ps(pz, _mm256_loadu_ps(&centreZ[i]));
+                const __m256 c = _mm256_loadu_ps(&cosAngle[i]);
+                const __m256 s = _mm256_loadu_ps(&sinAngle[i]);
+                const __m256 lx = _mm256_sub_ps(_mm256_mul_ps(dx, c), _mm256_mul_ps(dz, s));
+                const __m256 lz = _mm256_add_ps(_mm256_mul_ps(dx, s), _mm256_mul_ps(dz, c));
+
+                const __m256 ex = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, lx), hx), zero);
+                const __m256 ey = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, dy), hy), zero);
+                const __m256 ez = _mm256_max_ps(_mm256_sub_ps(_mm256_andnot_ps(sign, lz), hz), zero);
+                const __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)), _mm256_mul_ps(ez, ez));
+                nearest = _mm256_min_ps(nearest, dist2);
+            }
+
+            float lanes[8];
+            _mm256_storeu_ps(lanes, nearest);
+            for(int lane = 0; lane < 8; lane++) {best = fminf(best, lanes[lane]);}
+        }
+#elif defined(OBBSET_SSE2)
+        {
+            const __m128 px = _mm_set1_ps(point.x);
+            const __m128 py = _mm_set1_ps(point.y);
+            const __m128 pz = _mm_set1_ps(point.z);
+            const __m128 hx = _mm_set1_ps(half.x);
+            const __m128 hy = _mm_set1_ps(half.y);
+            const __m128 hz = _mm_set1_ps(half.z);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            __m128 nearest = _mm_set1_ps(INFINITY);
+            for(; i < count; i += 4)
+            {
+                const __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&centreX[i]));
+                const __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(&centreY[i]));
+                const __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&centreZ[i]));
+                const __m128 c = _mm_loadu_ps(&cosAngle[i]);
+                const __m128 s = _mm_loadu_ps(&sinAngle[i]);
+                const __m128 lx = _mm_sub_ps(_mm_mul_ps(dx, c), _mm_mul_ps(dz, s));
+                const __m128 lz = _mm_add_ps(_mm_mul_ps(dx, s), _mm_mul_ps(dz, c));
+
+                const __m128 ex = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, lx), hx), zero);
+                const __m128 ey = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, dy), hy), zero);
+                const __m128 ez = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, lz), hz), zero);
+                const __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+                nearest = _mm_min_ps(nearest, dist2);
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, nearest);
+            for(int lane = 0; lane < 4; lane++) {best = fminf(best, lanes[lane]);}
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            const float dx = point.x - centreX[i];
+            const float dy = point.y - centreY[i];
+            const float dz = point.z - centreZ[i];
+            const float lx = dx*cosAngle[i] - dz*sinAngle[i];
+            const float lz = dx*sinAngle[i] + dz*cosAngle[i];
+
+            const float ex = fmaxf(fabsf(lx) - half.x, 0);
+            const float ey = fmaxf(fabsf(dy) - half.y, 0);
+            const float ez = fmaxf(fabsf(lz) - half.z, 0);
+            best = fminf(best, ex*ex + ey*ey + ez*ez);
+        }
+
+        if(skip >= 0) {set(skip, {parked[0], parked[1], parked[2]}, parked[3], parked[4]);}
+        return best;
+    }
+};
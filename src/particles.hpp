@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "raylib.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define PARTICLES_SSE2 1
+#endif
+
+// Fixed-capacity particle pool for the short-lived effects: explosions,
+// cannon muzzle smoke and bullet splashes. Particles are kept as
+// structure-of-arrays, live ones packed at the front, so one tick is a single
+// 4-wide pass over every particle plus a pass that swaps dead ones out. A full
+// pool hands its slots out again round-robin instead of allocating. Emitters
+// draw from their own random sequence, so effects never shift gameplay.
+
+struct ParticlePose
+{
+    Vector3 prevPosition;
+    Vector3 position;
+    float prevRadius;
+    float radius;
+    Color color;        //alpha already faded by age
+};
+
+class ParticlePool
+{
+    private:
+    static constexpr float waterLevel = -1;     //where bullets are lost too; drops below it are gone
+
+    std::vector<float> x, y, z;
+    std::vector<float> prevX, prevY, prevZ;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> radius, prevRadius, growth;
+    std::vector<float> gravity, drag;
+    std::vector<float> age, life;
+    std::vector<Color> color;
+    int count;
+    int capacity;
+    int cursor;         //next slot to take over while full
+    uint32_t randomState;
+    float density;      //share of each emitter's particles actually spawned
+
+    float random(float min, float max)
+    {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return min + (max - min)*(randomState & 0xFFFFFF)/(float)0xFFFFFF;
+    }
+
+    //how many of an emitter's n particles this density allows, at least one
+    int scaled(int n)
+    {
+        const int scaledCount = (int)(n*density + 0.5f);
+        return scaledCount < 1 ? 1 : scaledCount;
+    }
+
+    void spawn(Vector3 position, Vector3 velocity, float startRadius, float radiusPerTick, float fall, float keep, float ticks, Color tint)
+    {
+        int i;
+        if(count < capacity) {i = count++;}
+        else
+        {
+            i = cursor;
+            cursor = (cursor + 1)%capacity;
+        }
+
+        x[i] = prevX[i] = position.x;
+        y[i] = prevY[i] = position.y;
+        z[i] = prevZ[i] = position.z;
+        vx[i] = velocity.x;
+        vy[i] = velocity.y;
+        vz[i] = velocity.z;
+        radius[i] = prevRadius[i] = startRadius;
+        growth[i] = radiusPerTick;
+        gravity[i] = fall;
+        drag[i] = keep;
+        age[i] = 0;
+        life[i] = ticks;
+        color[i] = tint;
+    }
+
+    //the last live particle takes slot i's place
+    void removeAt(int i)
+    {
+        const int last = --count;
+        x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+        prevX[i] = prevX[last]; prevY[i] = prevY[last]; prevZ[i] = prevZ[last];
+        vx[i] = vx[last]; vy[i] = vy[last]; vz[i] = vz[last];
+        radius[i] = radius[last]; prevRadius[i] = prevRadius[last]; growth[i] = growth[last];
+        gravity[i] = gravity[last]; drag[i] = drag[last];
+        age[i] = age[last]; life[i] = life[last];
+        color[i] = color[last];
+    }
+
+    public:
+    ParticlePool(int maxParticles) : count(0), cursor(0), randomState(0x9E3779B9u), density(1)
+    {
+        capacity = (maxParticles + 3)/4*4;
+        for(std::vector<float>* field : {&x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &radius, &prevRadius, &growth, &gravity, &drag, &age, &life})
+        {
+            field->assign(capacity, 0);
+        }
+        color.assign(capacity, BLANK);
+    }
+
+    //quality knob: 1 spawns every particle, 0 turns emitters off
+    void setDensity(float share)
+    {
+        density = share;
+    }
+
+    //a fireball that swells like the old explosion sphere, embers thrown
+    //outward and smoke that rises after them
+    void explosion(Vector3 at)
+    {
+        if(density <= 0) {return;}
+
+        spawn(at, {0, 0, 0}, 1, 2.0f/30, 0, 1, 30, RED);
+        for(int i = scaled(16); i > 0; i--)
+        {
+            const float heading = random(0, 2*PI);
+            const float speed = random(0.05f, 0.12f);
+            const Color tint = i%3 == 0 ? YELLOW : (i%3 == 1 ? ORANGE : RED);
+            spawn(at, {speed*sinf(heading), random(0.02f, 0.1f), speed*cosf(heading)}, random(0.5f, 0.9f), 0.02f, 0.002f, 0.92f, random(25, 40), tint);
+        }
+        for(int i = scaled(10); i > 0; i--)
+        {
+            const float heading = random(0, 2*PI);
+            const float speed = random(0.005f, 0.02f);
+            spawn({at.x, at.y + 0.5f, at.z}, {speed*sinf(heading), random(0.02f, 0.04f), speed*cosf(heading)},
+                  random(0.6f, 1.0f), 0.02f, -0.0005f, 0.97f, random(60, 100), {60, 60, 60, 255});
+        }
+    }
+
+    //grey puffs pushed out along the shot and slowed by the air
+    void muzzleSmoke(Vector3 at, Vector3 direction)
+    {
+        if(density <= 0) {return;}
+
+        for(int i = scaled(6); i > 0; i--)
+        {
+            const float speed = random(0.04f, 0.1f);
+            const Vector3 velocity = {direction.x*speed + random(-0.01f, 0.01f), random(0.005f, 0.02f), direction.z*speed + random(-0.01f, 0.01f)};
+            spawn(at, velocity, random(0.2f, 0.35f), 0.012f, -0.0003f, 0.9f, random(40, 70), {200, 200, 200, 255});
+        }
+    }
+
+    //a column of drops that falls back into the water and a ring of foam
+    void splash(Vector3 at)
+    {
+        if(density <= 0) {return;}
+
+        spawn(at, {0, 0, 0}, 0.3f, 0.03f, 0, 1, 30, RAYWHITE);
+        for(int i = scaled(12); i > 0; i--)
+        {
+            const float heading = random(0, 2*PI);
+            const float speed = random(0.01f, 0.04f);
+            spawn(at, {speed*sinf(heading), random(0.08f, 0.15f), speed*cosf(heading)}, random(0.1f, 0.2f), 0, 0.008f, 0.98f, 60, {200, 230, 255, 255});
+        }
+    }
+
+    //one tick: integrate everything, then swap out what expired or sank
+    void update()
+    {
+        int i = 0;
+
+#if defined(PARTICLES_SSE2)
+        const __m128 one = _mm_set1_ps(1);
+        for(; i + 4 <= count; i += 4)
+        {
+            const __m128 keep = _mm_loadu_ps(&drag[i]);
+            const __m128 px = _mm_loadu_ps(&x[i]);
+            const __m128 py = _mm_loadu_ps(&y[i]);
+            const __m128 pz = _mm_loadu_ps(&z[i]);
+            const __m128 velX = _mm_mul_ps(_mm_loadu_ps(&vx[i]), keep);
+            const __m128 velY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&vy[i]), _mm_loadu_ps(&gravity[i])), keep);
+            const __m128 velZ = _mm_mul_ps(_mm_loadu_ps(&vz[i]), keep);
+            _mm_storeu_ps(&prevX[i], px);
+            _mm_storeu_ps(&prevY[i], py);
+            _mm_storeu_ps(&prevZ[i], pz);
+            _mm_storeu_ps(&vx[i], velX);
+            _mm_storeu_ps(&vy[i], velY);
+            _mm_storeu_ps(&vz[i], velZ);
+            _mm_storeu_ps(&x[i], _mm_add_ps(px, velX));
+            _mm_storeu_ps(&y[i], _mm_add_ps(py, velY));
+            _mm_storeu_ps(&z[i], _mm_add_ps(pz, velZ));
+
+            const __m128 s = _mm_loadu_ps(&radius[i]);
+            _mm_storeu_ps(&prevRadius[i], s);
+            _mm_storeu_ps(&radius[i], _mm_add_ps(s, _mm_loadu_ps(&growth[i])));
+            _mm_storeu_ps(&age[i], _mm_add_ps(_mm_loadu_ps(&age[i]), one));
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            prevX[i] = x[i];
+            prevY[i] = y[i];
+            prevZ[i] = z[i];
+            vx[i] *= drag[i];
+            vy[i] = (vy[i] - gravity[i])*drag[i];
+            vz[i] *= drag[i];
+            x[i] += vx[i];
+            y[i] += vy[i];
+            z[i] += vz[i];
+            prevRadius[i] = radius[i];
+            radius[i] += growth[i];
+            age[i] += 1;
+        }
+
+        for(i = 0; i < count;)
+        {
+            if(age[i] >= life[i] || y[i] < waterLevel) {removeAt(i);}
+            else {i++;}
+        }
+        if(cursor >= count) {cursor = 0;}
+    }
+
+    void snapshot(std::vector<ParticlePose>& poses)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            Color tint = color[i];
+            tint.a = (unsigned char)(tint.a*(1 - age[i]/life[i]));
+            poses.push_back({{prevX[i], prevY[i], prevZ[i]}, {x[i], y[i], z[i]}, prevRadius[i], radius[i], tint});
+        }
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    //every per-particle array in a fixed order, for world saves: visit(data)
+    //gets float* for the numbers and Color* for the colours
+    template<typename Visit>
+    void forEachField(Visit visit)
+    {
+        for(std::vector<float>* field : {&x, &y, &z, &prevX, &prevY, &prevZ, &vx, &vy, &vz, &radius, &prevRadius, &growth, &gravity, &drag, &age, &life})
+        {
+            visit(field->data());
+        }
+        visit(color.data());
+    }
+
+    static const int bytesPerParticle = 16*sizeof(float) + sizeof(Color);
+
+    //live count for a restore that is about to fill the fields back in
+    void resize(int n)
+    {
+        count = n < capacity ? n : capacity;
+        cursor = 0;
+    }
+
+    void clear()
+    {
+        count = 0;
+        cursor = 0;
+    }
+};
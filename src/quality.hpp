@@ -0,0 +1,103 @@
+#pragma once
+
+// Quality tiers and the governor that moves between them. The governor keeps
+// a rolling average of the frame time and steps one tier down when it is over
+// budget, or one tier up when there is clear headroom. The gap between the
+// two thresholds plus a cooldown after every change keep it from oscillating.
+
+struct QualityTier
+{
+    const char* name;
+    float waveDensity;      //waves per square unit handed to Ocean
+    int trailInterval;      //simulation ticks between bullet trail samples
+    float particleDensity;  //share of every effect's particles that get spawned
+    int fullDetailEnemies;  //nearest enemies drawn with every sub-mesh
+};
+
+enum {QUALITY_LOW = 0, QUALITY_MEDIUM, QUALITY_HIGH, QUALITY_TIER_COUNT};
+
+const QualityTier qualityTiers[QUALITY_TIER_COUNT] = {
+    {"Low",    0.010f, 21, 0.4f, 2},
+    {"Medium", 0.018f, 14, 0.7f, 6},
+    {"High",   0.025f, 7,  1.0f, 1000},
+};
+
+class QualityGovernor
+{
+    private:
+    static const int windowSize = 60;
+
+    double window[windowSize];
+    double windowSum;
+    int windowIndex;
+    int windowCount;
+
+    double budget;
+    int tier;
+    int manualTier;     //-1 while the governor is in charge
+    int cooldown;
+
+    public:
+    QualityGovernor(double frameBudget) : budget(frameBudget)
+    {
+        for(int i = 0; i < windowSize; i++) {window[i] = 0;}
+        windowSum = 0;
+        windowIndex = 0;
+        windowCount = 0;
+        tier = QUALITY_HIGH;
+        manualTier = -1;
+        cooldown = 0;
+    }
+
+    //canLower/canRaise let other frame-time controllers (dynamic resolution)
+    //react first, so the two don't fight over the same headroom
+    void update(double frameTime, bool canLower = true, bool canRaise = true)
+    {
+        windowSum += frameTime - window[windowIndex];
+        window[windowIndex] = frameTime;
+        windowIndex = (windowIndex + 1)%windowSize;
+        if(windowCount < windowSize) {windowCount++;}
+
+        if(manualTier >= 0) {return;}
+        if(cooldown > 0)
+        {
+            cooldown--;
+            return;
+        }
+        if(windowCount < windowSize) {return;}
+
+        const double average = windowSum/windowSize;
+        if(average > budget*0.95 && canLower && tier > QUALITY_LOW)
+        {
+            tier--;
+            cooldown = 2*windowSize;
+        }
+        else if(average < budget*0.6 && canRaise && tier < QUALITY_HIGH)
+        {
+            tier++;
+            cooldown = 4*windowSize;
+        }
+    }
+
+    const QualityTier& current()
+    {
+        return qualityTiers[manualTier >= 0 ? manualTier : tier];
+    }
+
+    bool isAuto()
+    {
+        return manualTier < 0;
+    }
+
+    //-1 hands control back to the governor
+    void setOverride(int qualityTier)
+    {
+        manualTier = qualityTier;
+        cooldown = 2*windowSize;
+    }
+
+    int getOverride()
+    {
+        return manualTier;
+    }
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "raylib.h"
+#include "raymath.h"
+
+// Collects the draws of one frame, sorts them by a 64-bit key and submits
+// them grouped by state. Key layout, most significant first:
+//
+//   pass (4) | shader (8) | material (16) | mesh (16) | depth (20)
+//
+// so every pass is drawn in order, and inside a pass draws that share a
+// shader/material/mesh end up next to each other, nearest first. Given an
+// instancing shader, each such run of meshes is submitted as one instanced
+// draw, so a fleet or a sea of waves costs one call per sub-mesh.
+
+enum RenderPass
+{
+    PASS_OPAQUE = 0,    //meshes (ships, waves)
+    PASS_PRIMITIVE,     //immediate-mode spheres (bullets, trails)
+    PASS_HUD,           //world-space HUD (health bars)
+};
+
+class RenderQueue
+{
+    private:
+    enum ItemKind {ITEM_MESH, ITEM_SPHERE, ITEM_CUBE};
+
+    struct DrawItem
+    {
+        ItemKind kind;
+        const Mesh* mesh;
+        Material* material;
+        Matrix transform;
+        Vector3 position;
+        Vector3 size;       //cube size, x holds the sphere radius
+        int detail;         //sphere rings and slices
+        Color color;
+    };
+
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    std::vector<DrawItem> items;
+    std::vector<SortEntry> order;
+    std::vector<Matrix> instances;
+    Shader instanceShader;
+    int meshDraws;          //mesh draw calls the last flush made
+    Vector3 eye;
+    float maxDepth;
+
+    uint64_t depthBits(Vector3 position)
+    {
+        float d = Vector3Distance(eye, position)/maxDepth;
+        if(d < 0) {d = 0;}
+        if(d > 1) {d = 1;}
+        return (uint64_t)(d*0xFFFFF);
+    }
+
+    void push(uint64_t key, const DrawItem& item)
+    {
+        order.push_back({key, (uint32_t)items.size()});
+        items.push_back(item);
+    }
+
+    void pushMesh(const Mesh& mesh, Material* material, Matrix world, Vector3 position, Color tint, uint64_t depth)
+    {
+        DrawItem item = {ITEM_MESH, &mesh, material, world, position, {0, 0, 0}, 0, tint};
+        push(makeKey(PASS_OPAQUE, material->shader.id, material->maps[MATERIAL_MAP_DIFFUSE].texture.id, mesh.vaoId, depth), item);
+    }
+
+    public:
+    static uint64_t makeKey(RenderPass pass, unsigned int shader, unsigned int material, unsigned int mesh, uint64_t depth)
+    {
+        return ((uint64_t)(pass & 0xF) << 60) |
+               ((uint64_t)(shader & 0xFF) << 52) |
+               ((uint64_t)(material & 0xFFFF) << 36) |
+               ((uint64_t)(mesh & 0xFFFF) << 20) |
+               (depth & 0xFFFFF);
+    }
+
+    RenderQueue(float max_depth = 200.0f) : instanceShader({}), meshDraws(0), eye({0, 0, 0}), maxDepth(max_depth) {}
+
+    //a shader taking its model matrix from an instanceTransform attribute;
+    //until one is set (or with id 0) every mesh is a DrawMesh of its own
+    void setInstanceShader(Shader shader)
+    {
+        instanceShader = shader;
+    }
+
+    //starts a new frame; depth is measured from the camera position
+    void begin(Vector3 cameraPos)
+    {
+        eye = cameraPos;
+        items.clear();
+        order.clear();
+    }
+
+    //same placement as DrawModel(model, position, scale, tint), one item per sub-mesh;
+    //maxMeshes >= 0 only draws that many sub-meshes (low detail)
+    void pushModel(Model& model, Vector3 position, float scale, Color tint, int maxMeshes = -1)
+    {
+        pushModel(model, model.transform, position, scale, tint, maxMeshes);
+    }
+
+    //as above, with transform used in place of model.transform
+    void pushModel(Model& model, Matrix transform, Vector3 position, float scale, Color tint, int maxMeshes = -1)
+    {
+        Matrix world = MatrixMultiply(MatrixScale(scale, scale, scale), MatrixTranslate(position.x, position.y, position.z));
+        world = MatrixMultiply(transform, world);
+        const uint64_t depth = depthBits(position);
+
+        const int meshCount = (maxMeshes >= 0 && maxMeshes < model.meshCount) ? maxMeshes : model.meshCount;
+        for(int i = 0; i < meshCount; i++)
+        {
+            pushMesh(model.meshes[i], &model.materials[model.meshMaterial[i]], world, position, tint, depth);
+        }
+    }
+
+    //one mesh placed by its full world matrix; position is only for depth
+    void pushMesh(const Mesh& mesh, Material* material, Matrix world, Vector3 position, Color tint)
+    {
+        pushMesh(mesh, material, world, position, tint, depthBits(position));
+    }
+
+    //detail 16 matches DrawSphere
+    void pushSphere(RenderPass pass, Vector3 position, float radius, Color color, int detail = 16)
+    {
+        DrawItem item = {ITEM_SPHERE, nullptr, nullptr, MatrixIdentity(), position, {radius, 0, 0}, detail, color};
+        push(makeKey(pass, 0, 0, ITEM_SPHERE, depthBits(position)), item);
+    }
+
+    void pushCube(RenderPass pass, Vector3 position, Vector3 size, Color color)
+    {
+        DrawItem item = {ITEM_CUBE, nullptr, nullptr, MatrixIdentity(), position, size, 0, color};
+        push(makeKey(pass, 0, 0, ITEM_CUBE, depthBits(position)), item);
+    }
+
+    int size()
+    {
+        return items.size();
+    }
+
+    int drawCalls()
+    {
+        return meshDraws;
+    }
+
+    //sorts and draws everything queued since begin(); must be called inside BeginMode3D
+    void flush()
+    {
+        std::sort(order.begin(), order.end(), [](const SortEntry& a, const SortEntry& b) {return a.key < b.key;});
+
+        meshDraws = 0;
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            DrawItem& item = items[order[i].index];
+            switch(item.kind)
+            {
+                case ITEM_MESH:
+                {
+                    //the run of items after this one sharing its mesh, material and tint
+                    size_t end = i + 1;
+                    while(end < order.size())
+                    {
+                        const DrawItem& next = items[order[end].index];
+                        if(next.kind != ITEM_MESH || next.mesh != item.mesh || next.material != item.material ||
+                           next.color.r != item.color.r || next.color.g != item.color.g || next.color.b != item.color.b || next.color.a != item.color.a) {break;}
+                        end++;
+                    }
+                    if(instanceShader.id == 0) {end = i + 1;}
+
+                    //same tinting DrawModel does
+                    Color& diffuse = item.material->maps[MATERIAL_MAP_DIFFUSE].color;
+                    Color original = diffuse;
+                    diffuse.r = (unsigned char)(((int)original.r*(int)item.color.r)/255);
+                    diffuse.g = (unsigned char)(((int)original.g*(int)item.color.g)/255);
+                    diffuse.b = (unsigned char)(((int)original.b*(int)item.color.b)/255);
+                    diffuse.a = (unsigned char)(((int)original.a*(int)item.color.a)/255);
+                    if(end - i > 1)
+                    {
+                        instances.clear();
+                        for(size_t j = i; j < end; j++) {instances.push_back(items[order[j].index].transform);}
+                        Material instanced = *item.material;
+                        instanced.shader = instanceShader;
+                        DrawMeshInstanced(*item.mesh, instanced, instances.data(), instances.size());
+                    }
+                    else {DrawMesh(*item.mesh, *item.material, item.transform);}
+                    diffuse = original;
+                    meshDraws++;
+                    i = end - 1;
+                }break;
+                case ITEM_SPHERE:
+                    DrawSphereEx(item.position, item.size.x, item.detail, item.detail, item.color);
+                    break;
+                case ITEM_CUBE:
+                    DrawCube(item.position, item.size.x, item.size.y, item.size.z, item.color);
+                    break;
+            }
+        }
+
+        items.clear();
+        order.clear();
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "raylib.h"
+#include "rlgl.h"
+
+// Renders the 3D pass into an offscreen target at a fraction of the native
+// resolution and upscales it with a light sharpening filter. The scale moves
+// between minScale and maxScale in steps, driven by how long each frame took
+// to render (including the time the swap blocked on the GPU), with separate
+// up/down thresholds and a cooldown so it doesn't oscillate.
+
+inline const char* sharpenShaderCode = R"(
+#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform vec2 texelSize;
+uniform float sharpness;
+out vec4 finalColor;
+void main()
+{
+    vec3 c = texture(texture0, fragTexCoord).rgb;
+    vec3 n = texture(texture0, fragTexCoord + vec2(0.0, texelSize.y)).rgb;
+    vec3 s = texture(texture0, fragTexCoord - vec2(0.0, texelSize.y)).rgb;
+    vec3 e = texture(texture0, fragTexCoord + vec2(texelSize.x, 0.0)).rgb;
+    vec3 w = texture(texture0, fragTexCoord - vec2(texelSize.x, 0.0)).rgb;
+    vec3 result = c + sharpness*(4.0*c - n - s - e - w);
+    finalColor = vec4(clamp(result, 0.0, 1.0), 1.0)*colDiffuse*fragColor;
+}
+)";
+
+class DynamicResolution
+{
+    private:
+    RenderTexture2D target;     //allocated once at native size, drawn into a sub-viewport
+    Shader sharpen;
+    int sharpnessLoc;
+
+    float scale;
+    float minScale;
+    float maxScale;
+    float step;
+
+    double budget;              //seconds per frame
+    double smoothed;
+    int cooldown;
+    bool sceneDrawn;
+
+    int scaledWidth()
+    {
+        return (int)(target.texture.width*scale);
+    }
+
+    int scaledHeight()
+    {
+        return (int)(target.texture.height*scale);
+    }
+
+    public:
+    DynamicResolution(int width, int height, double frameBudget, float min_scale = 0.5f, float max_scale = 1.0f)
+    : minScale(min_scale), maxScale(max_scale), budget(frameBudget)
+    {
+        target = LoadRenderTexture(width, height);
+        SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+
+        sharpen = LoadShaderFromMemory(0, sharpenShaderCode);
+        sharpnessLoc = GetShaderLocation(sharpen, "sharpness");
+        Vector2 texelSize = {1.0f/width, 1.0f/height};
+        SetShaderValue(sharpen, GetShaderLocation(sharpen, "texelSize"), &texelSize, SHADER_UNIFORM_VEC2);
+
+        scale = maxScale;
+        step = 0.05f;
+        smoothed = frameBudget*0.5;
+        cooldown = 0;
+        sceneDrawn = false;
+    }
+
+    float getScale()
+    {
+        return scale;
+    }
+
+    bool atMinScale()
+    {
+        return scale <= minScale;
+    }
+
+    bool atMaxScale()
+    {
+        return scale >= maxScale;
+    }
+
+    void beginScene()
+    {
+        BeginTextureMode(target);
+        rlViewport(0, 0, scaledWidth(), scaledHeight());
+        sceneDrawn = true;
+    }
+
+    void endScene()
+    {
+        EndTextureMode();
+    }
+
+    //upscales the scaled scene over the whole screen
+    void present()
+    {
+        Rectangle source = {0, 0, (float)scaledWidth(), -(float)scaledHeight()};
+        Rectangle dest = {0, 0, (float)GetScreenWidth(), (float)GetScreenHeight()};
+
+        //no sharpening at native size, strongest at the minimum scale
+        float sharpness = 0.0f;
+        if(maxScale > minScale) {sharpness = 0.35f*(maxScale - scale)/(maxScale - minScale);}
+        SetShaderValue(sharpen, sharpnessLoc, &sharpness, SHADER_UNIFORM_FLOAT);
+
+        BeginShaderMode(sharpen);
+            DrawTexturePro(target.texture, source, dest, {0, 0}, 0, WHITE);
+        EndShaderMode();
+    }
+
+    //called once per frame with the time spent between BeginDrawing and the
+    //end of EndDrawing; frames without a 3D pass don't move the scale.
+    //returns whether this frame had a 3D pass
+    bool update(double frameTime)
+    {
+        if(!sceneDrawn) {return false;}
+        sceneDrawn = false;
+
+        smoothed = smoothed*0.9 + frameTime*0.1;
+        if(cooldown > 0)
+        {
+            cooldown--;
+            return true;
+        }
+
+        if(smoothed > budget*0.95 && scale > minScale)
+        {
+            scale -= step;
+            if(scale < minScale) {scale = minScale;}
+            cooldown = 30;
+        }
+        else if(smoothed < budget*0.75 && scale < maxScale)
+        {
+            scale += step;
+            if(scale > maxScale) {scale = maxScale;}
+            cooldown = 90;
+        }
+        return true;
+    }
+
+    //called before CloseWindow, the GL context has to outlive the target
+    void unload()
+    {
+        UnloadShader(sharpen);
+        UnloadRenderTexture(target);
+    }
+};
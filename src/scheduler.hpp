@@ -0,0 +1,358 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <algorithm>
+#include <vector>
+
+// Tick-driven coroutines for work that plays out over many ticks or frames:
+// enemy behaviours, the intro screens. A Task suspends on its Scheduler for a
+// number of ticks, until a given tick, or until a condition holds. Sleepers
+// wait in a heap ordered by wake tick and nothing looks at them before then,
+// so a sleeping task costs nothing per tick; condition waits are polled once
+// per run. Coroutine frames come from size-classed free lists, so once warm,
+// spawning and finishing tasks never reaches the heap. Like the world, the
+// frame pool and the game's schedulers belong to whichever thread is
+// simulating.
+
+class CoroutineFramePool
+{
+    private:
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    static const size_t granularity = 64;
+    static const size_t classCount = 16;        //frames up to 1 KB are pooled
+    static const int framesPerChunk = 32;
+
+    FreeFrame* freeLists[classCount];
+    std::vector<void*> chunks;
+
+    public:
+    CoroutineFramePool() : freeLists() {}
+
+    ~CoroutineFramePool()
+    {
+        for(void* chunk : chunks) {free(chunk);}
+    }
+
+    CoroutineFramePool(const CoroutineFramePool&) = delete;
+    CoroutineFramePool& operator=(const CoroutineFramePool&) = delete;
+
+    void* allocate(size_t bytes)
+    {
+        const size_t sizeClass = (bytes + granularity - 1)/granularity - 1;
+        if(sizeClass >= classCount) {return ::operator new(bytes);}
+
+        if(!freeLists[sizeClass])
+        {
+            const size_t frameBytes = (sizeClass + 1)*granularity;
+            char* chunk = (char*)malloc(frameBytes*framesPerChunk);
+            chunks.push_back(chunk);
+            for(int i = framesPerChunk - 1; i >= 0; i--)
+            {
+                FreeFrame* frame = (FreeFrame*)(chunk + i*frameBytes);
+                frame->next = freeLists[sizeClass];
+                freeLists[sizeClass] = frame;
+            }
+        }
+
+        FreeFrame* frame = freeLists[sizeClass];
+        freeLists[sizeClass] = frame->next;
+        return frame;
+    }
+
+    void release(void* memory, size_t bytes)
+    {
+        const size_t sizeClass = (bytes + granularity - 1)/granularity - 1;
+        if(sizeClass >= classCount)
+        {
+            ::operator delete(memory);
+            return;
+        }
+
+        FreeFrame* frame = (FreeFrame*)memory;
+        frame->next = freeLists[sizeClass];
+        freeLists[sizeClass] = frame;
+    }
+};
+inline CoroutineFramePool coroutineFrames;
+
+//a coroutine for a Scheduler to drive. it does nothing until spawned, and a
+//Task that is never spawned is never freed
+struct Task
+{
+    struct promise_type
+    {
+        uint32_t slot;      //in the scheduler that runs it
+
+        Task get_return_object()
+        {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {return {};}
+        std::suspend_always final_suspend() noexcept {return {};}
+        void return_void() {}
+        void unhandled_exception() {std::terminate();}
+
+        static void* operator new(size_t bytes)
+        {
+            return coroutineFrames.allocate(bytes);
+        }
+
+        static void operator delete(void* frame, size_t bytes)
+        {
+            coroutineFrames.release(frame, bytes);
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+//names a spawned task; stays safe to cancel after the task is gone
+struct TaskId
+{
+    uint32_t slot;
+    uint32_t generation;    //0 never names a live task
+};
+
+class Scheduler
+{
+    private:
+    typedef std::coroutine_handle<Task::promise_type> Handle;
+
+    struct Slot
+    {
+        Handle handle;
+        uint32_t generation;
+        unsigned long long int wake;    //tick it sleeps until, noWake while it waits on a condition
+    };
+
+    static const unsigned long long int noWake = ~0ull;
+
+    struct Wake
+    {
+        unsigned long long int tick;
+        TaskId task;
+    };
+
+    struct Waiter
+    {
+        bool (*holds)(void* awaiter);
+        void* awaiter;      //lives in the waiting task's frame
+        TaskId task;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<Wake> soon;         //due by the next run, kept out of the heap
+    std::vector<Wake> later;        //min-heap on tick
+    std::vector<Waiter> waiting;
+    std::vector<Wake> dueNow;       //scratch for run()
+    std::vector<Waiter> polling;
+    unsigned long long int now;
+    int live;
+
+    static bool wakesLater(const Wake& a, const Wake& b)
+    {
+        return a.tick > b.tick;
+    }
+
+    TaskId idOf(Handle handle)
+    {
+        const uint32_t slot = handle.promise().slot;
+        return {slot, slots[slot].generation};
+    }
+
+    void schedule(TaskId task, unsigned long long int tick)
+    {
+        slots[task.slot].wake = tick;
+        if(tick <= now + 1)
+        {
+            soon.push_back({tick, task});
+            return;
+        }
+        later.push_back({tick, task});
+        std::push_heap(later.begin(), later.end(), wakesLater);
+    }
+
+    void retire(uint32_t slot)
+    {
+        slots[slot].handle.destroy();
+        slots[slot].handle = nullptr;
+        if(++slots[slot].generation == 0) {slots[slot].generation = 1;}
+        freeSlots.push_back(slot);
+        live--;
+    }
+
+    void resume(TaskId task)
+    {
+        if(!alive(task)) {return;}
+        const Handle handle = slots[task.slot].handle;
+        slots[task.slot].wake = noWake;
+        handle.resume();
+        if(handle.done()) {retire(task.slot);}
+    }
+
+    public:
+    struct WakeAt
+    {
+        Scheduler* scheduler;
+        unsigned long long int tick;
+
+        bool await_ready() {return tick <= scheduler->now;}
+        void await_suspend(Handle handle) {scheduler->schedule(scheduler->idOf(handle), tick);}
+        void await_resume() {}
+    };
+
+    template<typename Condition>
+    struct WakeWhen
+    {
+        Scheduler* scheduler;
+        Condition condition;
+
+        static bool holds(void* awaiter)
+        {
+            return ((WakeWhen*)awaiter)->condition();
+        }
+
+        bool await_ready() {return condition();}
+        void await_suspend(Handle handle)
+        {
+            scheduler->slots[handle.promise().slot].wake = noWake;
+            scheduler->waiting.push_back({&holds, this, scheduler->idOf(handle)});
+        }
+        void await_resume() {}
+    };
+
+    Scheduler() : now(0), live(0) {}
+
+    ~Scheduler()
+    {
+        clear();
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    //the task first runs on the next run()
+    TaskId spawn(Task task)
+    {
+        uint32_t slot;
+        if(freeSlots.empty())
+        {
+            slot = slots.size();
+            slots.push_back({nullptr, 1, noWake});
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        slots[slot].handle = task.handle;
+        task.handle.promise().slot = slot;
+        const TaskId id = {slot, slots[slot].generation};
+        schedule(id, 0);
+        live++;
+        return id;
+    }
+
+    bool alive(TaskId task) const
+    {
+        return task.generation != 0 && task.slot < slots.size() && slots[task.slot].generation == task.generation;
+    }
+
+    //destroys the task wherever it is suspended; its queue entries go stale
+    void cancel(TaskId task)
+    {
+        if(alive(task)) {retire(task.slot);}
+    }
+
+    //drops whatever the task was waiting for and wakes it at tick instead;
+    //the old id goes stale, use the one returned. a task already asleep until
+    //tick is left alone
+    TaskId reschedule(TaskId task, unsigned long long int tick)
+    {
+        if(!alive(task) || slots[task.slot].wake == tick) {return task;}
+        if(++slots[task.slot].generation == 0) {slots[task.slot].generation = 1;}
+        const TaskId id = {task.slot, slots[task.slot].generation};
+        schedule(id, tick);
+        return id;
+    }
+
+    void clear()
+    {
+        for(uint32_t i = 0; i < slots.size(); i++)
+        {
+            if(slots[i].handle) {retire(i);}
+        }
+        soon.clear();
+        later.clear();
+        waiting.clear();
+    }
+
+    //resumes every task due by tick: those sleeping until then, then those
+    //whose condition now holds
+    void run(unsigned long long int tick)
+    {
+        now = tick;
+
+        dueNow.swap(soon);
+        for(const Wake& wake : dueNow)
+        {
+            if(!alive(wake.task)) {continue;}
+            if(wake.tick <= tick) {resume(wake.task);}
+            else {soon.push_back(wake);}
+        }
+        dueNow.clear();
+
+        while(!later.empty() && later.front().tick <= tick)
+        {
+            std::pop_heap(later.begin(), later.end(), wakesLater);
+            const TaskId task = later.back().task;
+            later.pop_back();
+            resume(task);
+        }
+
+        polling.swap(waiting);
+        for(const Waiter& waiter : polling)
+        {
+            if(!alive(waiter.task)) {continue;}
+            if(waiter.holds(waiter.awaiter)) {resume(waiter.task);}
+            else {waiting.push_back(waiter);}
+        }
+        polling.clear();
+    }
+
+    WakeAt at(unsigned long long int tick)
+    {
+        return {this, tick};
+    }
+
+    WakeAt sleep(int ticks)
+    {
+        return {this, now + (ticks > 0 ? ticks : 0)};
+    }
+
+    template<typename Condition>
+    WakeWhen<Condition> until(Condition condition)
+    {
+        return {this, condition};
+    }
+
+    unsigned long long int tick() const
+    {
+        return now;
+    }
+
+    int size() const
+    {
+        return live;
+    }
+};
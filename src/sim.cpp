@@ -0,0 +1,266 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <chrono>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+#include "game.hpp"
+
+// kapal_sim: headless batch match runner for balancing and AI tuning.
+// Plays N independent matches of the game's own gameplay code as fast as
+// possible, with no window and no raylib library. The gameplay world lives in
+// globals, so matches run in parallel as one worker process per core. Workers
+// pull match indices from a shared counter and write fixed-size results into
+// shared memory, which the parent turns into the outcome file.
+
+struct MatchConfig
+{
+    int ticks;          //time limit per match
+    int startingEnemy;
+    int maxEnemy;
+    uint32_t seed;      //match i plays with seed + i
+};
+
+struct MatchResult
+{
+    uint32_t match;
+    uint32_t seed;
+    uint32_t ticks;     //ticks played before the player sank or time ran out
+    uint32_t kills;
+    uint32_t enemies;   //active enemies at the end
+    uint32_t hitsLanded;    //the player's shots that hit
+    uint32_t hitsTaken;
+    float health;       //player health at the end, <= 0 means the player sank
+    float seconds;      //wall time of the match on its worker
+};
+
+//stands in for the keyboard: closes in on the nearest enemy, then turns it
+//onto a beam and fires the broadside that bears
+InputState autopilot(MKapal& player)
+{
+    InputState input = {};
+
+    EKapal* nearest = nullptr;
+    float nearestDist = INFINITY;
+    for(int i = 0; i < enemyKapals.size() && enemyKapals[i]->isActive(); i++)
+    {
+        float dist = Vector3Distance(player.getPos(), enemyKapals[i]->getPos());
+        if(dist < nearestDist)
+        {
+            nearest = enemyKapals[i];
+            nearestDist = dist;
+        }
+    }
+    if(nearest == nullptr) {return input;}
+
+    //bearing of the enemy relative to the bow, (-180, 180], positive to port
+    Vector3 toEnemy = Vector3Subtract(nearest->getPos(), player.getPos());
+    float bearing = atan2f(toEnemy.x, toEnemy.z)*RAD2DEG - player.getAngle();
+    while(bearing > 180) {bearing -= 360;}
+    while(bearing <= -180) {bearing += 360;}
+
+    const float attackRange = 20.0f;
+    const float tolerance = 5.0f;
+    float error = bearing;
+    if(nearestDist < attackRange) {error = bearing > 0 ? bearing - 90 : bearing + 90;}
+
+    input.forward = true;
+    input.left = error > tolerance;
+    input.right = error < -tolerance;
+    input.fireLeft = nearestDist < attackRange + 5 && fabsf(bearing - 90) < 10;
+    input.fireRight = nearestDist < attackRange + 5 && fabsf(bearing + 90) < 10;
+    return input;
+}
+
+MatchResult runMatch(uint32_t index, const MatchConfig& config)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    MatchResult result = {};
+    result.match = index;
+    result.seed = config.seed + index;
+    seedGameRandom(result.seed);
+    tickCounter = 0;
+    {
+        MyCam camera({0, 0, 0});
+        MKapal player({0, 1.5, 0}, 0, &camera, enemyKapals_copy);
+
+        for(int i = 0; i < config.maxEnemy; i++)
+        {
+            createEnemyKapal(getRandomPos(player.getPos(), 23.67379f, false), gameRandom(0, 360), &player);
+        }
+        for(int i = 0; i < config.startingEnemy; i++)
+        {
+            enemyKapals[i]->setActive(true, getRandomPos(player.getPos(), 23.67379f, false));
+        }
+        int activeEnemy = config.startingEnemy;
+
+        //waves don't touch the outcome, keep as few as the game ever does
+        Ocean ocean(100, &camera, 0.01, qualityTiers[QUALITY_LOW].waveDensity);
+        applySimQuality(qualityTiers[QUALITY_LOW], ocean);
+        particles.setDensity(0);    //nor do effects
+
+        while(result.ticks < config.ticks && player.getHealth() > 0)
+        {
+            result.kills += gameplayUpdate(player, ocean, activeEnemy, config.maxEnemy, autopilot(player));
+            tickCounter++;
+            result.ticks++;
+        }
+
+        result.enemies = activeEnemy;
+        result.health = player.getHealth();
+        result.hitsLanded = hitStats.landed;
+        result.hitsTaken = hitStats.taken;
+        clearWorld();
+    }
+
+    result.seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void runWorker(std::atomic<uint32_t>& nextMatch, int matches, const MatchConfig& config, MatchResult* results)
+{
+    while(true)
+    {
+        uint32_t index = nextMatch.fetch_add(1);
+        if(index >= (uint32_t)matches) {return;}
+        results[index] = runMatch(index, config);
+    }
+}
+
+//runs every match and fills results; returns false if a worker failed
+bool runMatches(int matches, int jobs, const MatchConfig& config, MatchResult* results)
+{
+    std::atomic<uint32_t> localCounter(0);
+#if defined(__unix__) || defined(__APPLE__)
+    if(jobs > 1)
+    {
+        //the counter is shared with the workers; lock-free atomics work across processes
+        void* shared = mmap(nullptr, sizeof(std::atomic<uint32_t>) + sizeof(MatchResult)*matches, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(shared == MAP_FAILED)
+        {
+            std::cout<<"could not map shared memory, running on one core\n";
+        }
+        else
+        {
+            std::atomic<uint32_t>* nextMatch = new (shared) std::atomic<uint32_t>(0);
+            MatchResult* sharedResults = (MatchResult*)((char*)shared + sizeof(std::atomic<uint32_t>));
+
+            std::vector<pid_t> workers;
+            for(int i = 0; i < jobs; i++)
+            {
+                pid_t pid = fork();
+                if(pid == 0)
+                {
+                    runWorker(*nextMatch, matches, config, sharedResults);
+                    _exit(0);
+                }
+                if(pid > 0) {workers.push_back(pid);}
+            }
+
+            bool ok = !workers.empty();
+            for(pid_t pid : workers)
+            {
+                int status = 0;
+                waitpid(pid, &status, 0);
+                if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {ok = false;}
+            }
+
+            memcpy(results, sharedResults, sizeof(MatchResult)*matches);
+            munmap(shared, sizeof(std::atomic<uint32_t>) + sizeof(MatchResult)*matches);
+            return ok;
+        }
+    }
+#endif
+    runWorker(localCounter, matches, config, results);
+    return true;
+}
+
+bool saveResults(const std::string& path, const MatchConfig& config, const std::vector<MatchResult>& results)
+{
+    std::ofstream file(path);
+    if(!file) {return false;}
+    file << "# kapal_sim ticks " << config.ticks << " enemies " << config.startingEnemy << "-" << config.maxEnemy << " seed " << config.seed << "\n";
+    file << "# match seed outcome ticks kills enemies health seconds landed taken\n";
+    for(const MatchResult& r : results)
+    {
+        file << r.match << " " << r.seed << " " << (r.health > 0 ? "survived" : "sunk") << " " << r.ticks << " " << r.kills << " "
+             << r.enemies << " " << r.health << " " << r.seconds << " " << r.hitsLanded << " " << r.hitsTaken << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int matches = 1000;
+    int jobs = std::thread::hardware_concurrency();
+    MatchConfig config = {3*60*tickRate, 2, 11, 5024};
+    std::string outPath = "matches.txt";
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--matches") && i + 1 < argc) {matches = atoi(argv[++i]);}
+        else if(!strcmp(argv[i], "--jobs") && i + 1 < argc) {jobs = atoi(argv[++i]);}
+        else if(!strcmp(argv[i], "--ticks") && i + 1 < argc) {config.ticks = atoi(argv[++i]);}
+        else if(!strcmp(argv[i], "--enemies") && i + 1 < argc) {config.maxEnemy = atoi(argv[++i]);}
+        else if(!strcmp(argv[i], "--starting-enemies") && i + 1 < argc) {config.startingEnemy = atoi(argv[++i]);}
+        else if(!strcmp(argv[i], "--seed") && i + 1 < argc) {config.seed = strtoul(argv[++i], nullptr, 10);}
+        else if(!strcmp(argv[i], "--out") && i + 1 < argc) {outPath = argv[++i];}
+        else
+        {
+            std::cout<<"usage: "<<argv[0]<<" [--matches 1000] [--jobs cores] [--ticks 10800] [--enemies 11] [--starting-enemies 2] [--seed 5024] [--out matches.txt]\n";
+            return 2;
+        }
+    }
+    if(jobs < 1) {jobs = 1;}
+    if(matches < 1) {matches = 1;}
+    if(config.startingEnemy > config.maxEnemy) {config.startingEnemy = config.maxEnemy;}
+
+    std::vector<MatchResult> results(matches);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = runMatches(matches, jobs, config, results.data());
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(!ok)
+    {
+        std::cout<<"a worker process failed, results are incomplete\n";
+        return 1;
+    }
+    if(!saveResults(outPath, config, results))
+    {
+        std::cout<<"could not write "<<outPath<<"\n";
+        return 1;
+    }
+
+    int survived = 0;
+    double kills = 0;
+    double ticks = 0;
+    double landed = 0;
+    double taken = 0;
+    double busy = 0;
+    for(const MatchResult& r : results)
+    {
+        if(r.health > 0) {survived++;}
+        kills += r.kills;
+        ticks += r.ticks;
+        landed += r.hitsLanded;
+        taken += r.hitsTaken;
+        busy += r.seconds;
+    }
+
+    std::cout<<matches<<" matches on "<<jobs<<" core(s) in "<<wall<<" s\n";
+    std::cout<<"throughput "<<matches/wall<<" matches/s, "<<matches/wall/jobs<<" matches/s/core ("<<(busy > 0 ? matches/busy : 0)<<" per busy core-second)\n";
+    std::cout<<"survived "<<100.0*survived/matches<<"%, mean kills "<<kills/matches<<", mean length "<<ticks/matches<<" ticks\n";
+    std::cout<<"mean hits landed "<<landed/matches<<", taken "<<taken/matches<<"\n";
+    std::cout<<"results written to "<<outPath<<"\n";
+    return 0;
+}
@@ -0,0 +1,423 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define TELEMETRY_HTTP 1
+#endif
+
+// Metrics for long sessions: HDR-style histograms of frame, simulation,
+// render and present time plus gauges for what the world holds. Recording
+// is a few relaxed atomic adds, so the render and simulation threads write
+// without locks. An exporter thread, started only when asked for, serves the
+// registry as Prometheus text on localhost and appends one line per interval
+// to a rotating log, with that interval's own percentiles so a slow drift
+// over hours shows up instead of drowning in the lifetime totals.
+
+//log-linear buckets over microseconds: exact up to 255, then 128 buckets per
+//power of two, so every value lands within 1% of its bucket's bounds
+class HdrHistogram
+{
+    public:
+    static const int subBits = 7;
+    static const int linearCount = 2 << subBits;            //values below this get a bucket each
+    static const int maxMagnitude = 36 - subBits - 1;       //up to 2^36 us, about 19 hours
+    static const int bucketCount = linearCount + maxMagnitude*(1 << subBits);
+
+    private:
+    std::atomic<uint64_t> counts[bucketCount];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sumMicros;
+    std::atomic<uint64_t> maxMicros;
+
+    static int indexOf(uint64_t micros)
+    {
+        if(micros < (uint64_t)linearCount) {return (int)micros;}
+        const int magnitude = (std::bit_width(micros) - 1) - subBits;
+        if(magnitude > maxMagnitude) {return bucketCount - 1;}
+        return linearCount + (magnitude - 1)*(1 << subBits) + (int)((micros >> magnitude) - (1 << subBits));
+    }
+
+    public:
+    HdrHistogram() : total(0), sumMicros(0), maxMicros(0)
+    {
+        for(std::atomic<uint64_t>& count : counts) {count.store(0, std::memory_order_relaxed);}
+    }
+
+    //highest value that lands in bucket index
+    static uint64_t upperBound(int index)
+    {
+        if(index < linearCount) {return index;}
+        const int magnitude = (index - linearCount)/(1 << subBits) + 1;
+        const uint64_t sub = (1 << subBits) + (index - linearCount)%(1 << subBits);
+        return ((sub + 1) << magnitude) - 1;
+    }
+
+    void record(double seconds)
+    {
+        const uint64_t micros = seconds > 0 ? (uint64_t)(seconds*1e6) : 0;
+        counts[indexOf(micros)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sumMicros.fetch_add(micros, std::memory_order_relaxed);
+        uint64_t seen = maxMicros.load(std::memory_order_relaxed);
+        while(micros > seen && !maxMicros.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {}
+    }
+
+    //every bucket's count, for percentiles over an interval (the difference
+    //of two copies)
+    void copyCounts(std::vector<uint64_t>& out)
+    {
+        out.resize(bucketCount);
+        for(int i = 0; i < bucketCount; i++) {out[i] = counts[i].load(std::memory_order_relaxed);}
+    }
+
+    //seconds at quantile q of the given bucket counts
+    static double quantile(const std::vector<uint64_t>& bucketCounts, double q)
+    {
+        uint64_t all = 0;
+        for(uint64_t count : bucketCounts) {all += count;}
+        if(all == 0) {return 0;}
+
+        const uint64_t rank = (uint64_t)ceil(q*all);
+        uint64_t seen = 0;
+        for(int i = 0; i < (int)bucketCounts.size(); i++)
+        {
+            seen += bucketCounts[i];
+            if(seen >= rank && bucketCounts[i] > 0) {return upperBound(i)*1e-6;}
+        }
+        return upperBound(bucketCount - 1)*1e-6;
+    }
+
+    uint64_t count()
+    {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    double sum()
+    {
+        return sumMicros.load(std::memory_order_relaxed)*1e-6;
+    }
+
+    double max()
+    {
+        return maxMicros.load(std::memory_order_relaxed)*1e-6;
+    }
+};
+
+class Gauge
+{
+    private:
+    std::atomic<double> value;
+
+    public:
+    Gauge() : value(0) {}
+
+    void set(double v)
+    {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    double get()
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+//resident set size right now; the peak where the platform has nothing better
+inline double residentBytes()
+{
+#if defined(__linux__)
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm)
+    {
+        long pages = 0;
+        long resident = 0;
+        const int read = fscanf(statm, "%ld %ld", &pages, &resident);
+        fclose(statm);
+        if(read == 2) {return (double)resident*sysconf(_SC_PAGESIZE);}
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return (double)usage.ru_maxrss;
+#else
+    return (double)usage.ru_maxrss*1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+class Telemetry
+{
+    public:
+    HdrHistogram frame;         //whole frame on the render thread, before the fps cap waits
+    HdrHistogram simulation;    //one tick, whichever thread ran it
+    HdrHistogram render;        //BeginDrawing up to EndDrawing
+    HdrHistogram present;       //EndDrawing itself: buffer swap and event polling
+    Gauge bullets;
+    Gauge enemies;              //active ones
+    Gauge waves;
+    Gauge particles;
+    Gauge resident;             //bytes, refreshed by the exporter
+
+    private:
+    struct HistogramEntry
+    {
+        const char* name;
+        const char* help;
+        HdrHistogram* histogram;
+        std::vector<uint64_t> lastCounts;   //at the previous log line
+    };
+
+    struct GaugeEntry
+    {
+        const char* name;
+        const char* help;
+        Gauge* gauge;
+    };
+
+    std::vector<HistogramEntry> histograms;
+    std::vector<GaugeEntry> gauges;
+
+    std::thread exporter;
+    std::atomic<bool> running;
+    int port;
+    std::string logPath;
+    double logInterval;
+    long logLimit;              //bytes before the log rotates
+    int logKeep;                //rotated files kept: path.1 ... path.logKeep
+    double startTime;
+
+    static double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void rotate()
+    {
+        for(int i = logKeep; i > 0; i--)
+        {
+            const std::string from = i == 1 ? logPath : logPath + "." + std::to_string(i - 1);
+            std::rename(from.c_str(), (logPath + "." + std::to_string(i)).c_str());
+        }
+    }
+
+    //one line: wall time, uptime, p50/p99/max of every histogram over the
+    //interval since the last line, then the gauges
+    void appendLog()
+    {
+        resident.set(residentBytes());
+
+        FILE* file = fopen(logPath.c_str(), "a");
+        if(!file) {return;}
+        fseek(file, 0, SEEK_END);
+        if(ftell(file) == 0)
+        {
+            fprintf(file, "# time uptime_s");
+            for(const HistogramEntry& entry : histograms) {fprintf(file, " %s_p50_ms %s_p99_ms %s_max_ms %s_n", entry.name, entry.name, entry.name, entry.name);}
+            for(const GaugeEntry& entry : gauges) {fprintf(file, " %s", entry.name);}
+            fprintf(file, "\n");
+        }
+
+        fprintf(file, "%ld %.1f", (long)time(nullptr), now() - startTime);
+        std::vector<uint64_t> counts;
+        for(HistogramEntry& entry : histograms)
+        {
+            entry.histogram->copyCounts(counts);
+            std::vector<uint64_t> interval(counts.size());
+            uint64_t n = 0;
+            int highest = -1;
+            for(size_t i = 0; i < counts.size(); i++)
+            {
+                interval[i] = counts[i] - (entry.lastCounts.empty() ? 0 : entry.lastCounts[i]);
+                n += interval[i];
+                if(interval[i] > 0) {highest = i;}
+            }
+            const double intervalMax = highest >= 0 ? HdrHistogram::upperBound(highest)*1e-6 : 0;
+            fprintf(file, " %.3f %.3f %.3f %llu", HdrHistogram::quantile(interval, 0.5)*1e3, HdrHistogram::quantile(interval, 0.99)*1e3, intervalMax*1e3, (unsigned long long)n);
+            entry.lastCounts.swap(counts);
+        }
+        for(const GaugeEntry& entry : gauges) {fprintf(file, " %.0f", entry.gauge->get());}
+        fprintf(file, "\n");
+
+        const long size = ftell(file);
+        fclose(file);
+        if(size > logLimit) {rotate();}
+    }
+
+#if defined(TELEMETRY_HTTP)
+    int listenSocket()
+    {
+        const int server = socket(AF_INET, SOCK_STREAM, 0);
+        if(server < 0) {return -1;}
+        const int reuse = 1;
+        setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);     //never reachable from outside the cabinet
+        if(bind(server, (sockaddr*)&address, sizeof(address)) < 0 || listen(server, 4) < 0)
+        {
+            close(server);
+            return -1;
+        }
+        return server;
+    }
+
+    //one request per connection; anything but GET /metrics is a 404
+    void serve(int server)
+    {
+        const int client = accept(server, nullptr, nullptr);
+        if(client < 0) {return;}
+
+        pollfd ready = {client, POLLIN, 0};
+        char request[1024] = {};
+        if(poll(&ready, 1, 1000) > 0) {recv(client, request, sizeof(request) - 1, 0);}
+
+        std::string body;
+        std::string status = "404 Not Found";
+        if(!strncmp(request, "GET /metrics ", 13) || !strncmp(request, "GET /metrics?", 13))
+        {
+            resident.set(residentBytes());
+            prometheus(body);
+            status = "200 OK";
+        }
+        const std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                                     std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        for(size_t sent = 0; sent < response.size();)
+        {
+            const ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if(n <= 0) {break;}
+            sent += n;
+        }
+        close(client);
+    }
+#endif
+
+    void run()
+    {
+        int server = -1;
+#if defined(TELEMETRY_HTTP)
+        if(port > 0)
+        {
+            server = listenSocket();
+            if(server < 0) {fprintf(stderr, "telemetry: could not listen on 127.0.0.1:%d\n", port);}
+        }
+#endif
+
+        double nextLog = now() + logInterval;
+        while(running.load())
+        {
+#if defined(TELEMETRY_HTTP)
+            if(server >= 0)
+            {
+                pollfd ready = {server, POLLIN, 0};
+                if(poll(&ready, 1, 250) > 0) {serve(server);}
+            }
+            else {std::this_thread::sleep_for(std::chrono::milliseconds(250));}
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+#endif
+            if(!logPath.empty() && now() >= nextLog)
+            {
+                appendLog();
+                nextLog += logInterval;
+            }
+        }
+
+#if defined(TELEMETRY_HTTP)
+        if(server >= 0) {close(server);}
+#endif
+        if(!logPath.empty()) {appendLog();}
+    }
+
+    public:
+    Telemetry() : running(false), port(0), logInterval(60), logLimit(4 << 20), logKeep(3)
+    {
+        histograms = {
+            {"kapal_frame_seconds", "Render thread frame time, excluding the frame cap wait", &frame, {}},
+            {"kapal_simulation_seconds", "Time to run one simulation tick", &simulation, {}},
+            {"kapal_render_seconds", "Time from BeginDrawing to EndDrawing", &render, {}},
+            {"kapal_present_seconds", "Time spent in EndDrawing", &present, {}},
+        };
+        gauges = {
+            {"kapal_bullets", "Bullets in flight", &bullets},
+            {"kapal_active_enemies", "Enemy ships in play", &enemies},
+            {"kapal_waves", "Wave meshes on the ocean", &waves},
+            {"kapal_particles", "Live effect particles", &particles},
+            {"kapal_resident_bytes", "Resident memory of the process", &resident},
+        };
+        startTime = now();
+    }
+
+    ~Telemetry()
+    {
+        stop();
+    }
+
+    //port 0 leaves out the endpoint, an empty path the log
+    void start(int httpPort, const std::string& path, double intervalSeconds)
+    {
+        if(running.load()) {return;}
+        port = httpPort;
+        logPath = path;
+        logInterval = intervalSeconds > 0 ? intervalSeconds : 60;
+        running.store(true);
+        exporter = std::thread(&Telemetry::run, this);
+    }
+
+    void stop()
+    {
+        running.store(false);
+        if(exporter.joinable()) {exporter.join();}
+    }
+
+    //the whole registry in the Prometheus text exposition format; histograms
+    //go out as summaries over the whole session
+    void prometheus(std::string& out)
+    {
+        char line[256];
+        std::vector<uint64_t> counts;
+        for(HistogramEntry& entry : histograms)
+        {
+            entry.histogram->copyCounts(counts);
+            snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s summary\n", entry.name, entry.help, entry.name);
+            out += line;
+            for(double q : {0.5, 0.9, 0.99, 0.999})
+            {
+                snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %.6f\n", entry.name, q, HdrHistogram::quantile(counts, q));
+                out += line;
+            }
+            snprintf(line, sizeof(line), "%s_sum %.6f\n%s_count %llu\n", entry.name, entry.histogram->sum(), entry.name, (unsigned long long)entry.histogram->count());
+            out += line;
+            snprintf(line, sizeof(line), "# HELP %s_max Longest one seen\n# TYPE %s_max gauge\n%s_max %.6f\n", entry.name, entry.name, entry.name, entry.histogram->max());
+            out += line;
+        }
+        for(const GaugeEntry& entry : gauges)
+        {
+            snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %.0f\n", entry.name, entry.help, entry.name, entry.name, entry.gauge->get());
+            out += line;
+        }
+    }
+};
+
+inline Telemetry telemetry;
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <cstring>
+#include "raylib.h"
+#include "texpack.hpp"
+
+// kapal_texpack: build-time texture packer. Loads an image, builds its full
+// mip chain and writes it as a packed texture (texpack.hpp), BC1-compressed
+// unless --rgba is given. Runs as part of the build for every texture the
+// game samples; needs raylib's image code but never opens a window.
+
+int main(int argc, char** argv)
+{
+    bool compress = true;
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--rgba")) {compress = false;}
+        else if(!inPath) {inPath = argv[i];}
+        else if(!outPath) {outPath = argv[i];}
+        else {inPath = nullptr; break;}
+    }
+    if(!inPath || !outPath)
+    {
+        std::cout<<"usage: "<<argv[0]<<" [--rgba] in.png out.dds\n";
+        return 2;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    Image image = LoadImage(inPath);
+    if(!image.data)
+    {
+        std::cout<<"could not load "<<inPath<<"\n";
+        return 1;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageMipmaps(&image);
+
+    const bool ok = savePackedTexture(outPath, image, compress);
+    UnloadImage(image);
+    if(!ok)
+    {
+        std::cout<<"could not write "<<outPath<<"\n";
+        return 1;
+    }
+    return 0;
+}
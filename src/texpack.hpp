@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include "raylib.h"
+
+// Packed textures: a full mip chain stored as a DDS file, either plain RGBA8
+// or BC1 (DXT1) blocks for opaque art, so the game uploads every level as-is
+// instead of decoding a PNG and building mipmaps at startup. kapal_texpack
+// writes them at build time; the game reads them back with
+// loadPackedTexture. Only the subset of DDS written here is understood.
+
+const uint32_t ddsMagic = 0x20534444;            //"DDS "
+const uint32_t ddsFourCCDXT1 = 0x31545844;       //"DXT1"
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipmapCount;
+    uint32_t reserved1[11];
+    uint32_t formatSize;
+    uint32_t formatFlags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rMask, gMask, bMask, aMask;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header is 124 bytes on disk");
+
+//bytes in one mip level, for the two formats packed textures come in
+inline int packedLevelSize(int width, int height, int format)
+{
+    if(format == PIXELFORMAT_COMPRESSED_DXT1_RGB) {return ((width + 3)/4)*((height + 3)/4)*8;}
+    return width*height*4;
+}
+
+inline uint16_t packRGB565(int r, int g, int b)
+{
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+inline void unpackRGB565(uint16_t c, int rgb[3])
+{
+    rgb[0] = ((c >> 11) & 31)*255/31;
+    rgb[1] = ((c >> 5) & 63)*255/63;
+    rgb[2] = (c & 31)*255/31;
+}
+
+//one 4x4 RGBA8 block to BC1: the colour bounding box, inset a little, gives
+//the two endpoints and every texel takes the nearest of the four colours
+inline void encodeBC1Block(const unsigned char texels[16][4], unsigned char out[8])
+{
+    int low[3] = {255, 255, 255};
+    int high[3] = {0, 0, 0};
+    for(int i = 0; i < 16; i++)
+    {
+        for(int c = 0; c < 3; c++)
+        {
+            if(texels[i][c] < low[c]) {low[c] = texels[i][c];}
+            if(texels[i][c] > high[c]) {high[c] = texels[i][c];}
+        }
+    }
+    for(int c = 0; c < 3; c++)
+    {
+        const int inset = (high[c] - low[c])/16;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+
+    uint16_t c0 = packRGB565(high[0], high[1], high[2]);
+    uint16_t c1 = packRGB565(low[0], low[1], low[2]);
+    if(c0 < c1) {uint16_t swap = c0; c0 = c1; c1 = swap;}
+
+    uint32_t indices = 0;
+    if(c0 != c1)
+    {
+        int palette[4][3];
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for(int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2*palette[0][c] + palette[1][c])/3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c])/3;
+        }
+
+        for(int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestDist = 1 << 30;
+            for(int p = 0; p < 4; p++)
+            {
+                const int dr = texels[i][0] - palette[p][0];
+                const int dg = texels[i][1] - palette[p][1];
+                const int db = texels[i][2] - palette[p][2];
+                const int dist = dr*dr + dg*dg + db*db;
+                if(dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2*i);
+        }
+    }
+
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+//one RGBA8 level to BC1, edge texels repeated into partial blocks
+inline void encodeBC1(const unsigned char* pixels, int width, int height, unsigned char* out)
+{
+    unsigned char block[16][4];
+    for(int by = 0; by < height; by += 4)
+    {
+        for(int bx = 0; bx < width; bx += 4)
+        {
+            for(int i = 0; i < 16; i++)
+            {
+                const int x = bx + i%4 < width ? bx + i%4 : width - 1;
+                const int y = by + i/4 < height ? by + i/4 : height - 1;
+                memcpy(block[i], pixels + 4*(y*width + x), 4);
+            }
+            encodeBC1Block(block, out);
+            out += 8;
+        }
+    }
+}
+
+//image must be RGBA8 with its mip chain already built (ImageMipmaps)
+inline bool savePackedTexture(const char* path, Image image, bool compress)
+{
+    if(image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {return false;}
+    const int format = compress ? PIXELFORMAT_COMPRESSED_DXT1_RGB : PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+    DDSHeader header = {};
+    header.size = 124;
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | (compress ? 0x80000 : 0x8);   //caps, height, width, pixel format, mip count, linear size or pitch
+    header.height = image.height;
+    header.width = image.width;
+    header.pitchOrLinearSize = compress ? packedLevelSize(image.width, image.height, format) : image.width*4;
+    header.mipmapCount = image.mipmaps;
+    header.formatSize = 32;
+    if(compress)
+    {
+        header.formatFlags = 0x4;           //fourCC
+        header.fourCC = ddsFourCCDXT1;
+    }
+    else
+    {
+        header.formatFlags = 0x1 | 0x40;    //alpha pixels, rgb
+        header.rgbBitCount = 32;
+        header.rMask = 0x000000FF;
+        header.gMask = 0x0000FF00;
+        header.bMask = 0x00FF0000;
+        header.aMask = 0xFF000000;
+    }
+    header.caps = 0x1000 | (image.mipmaps > 1 ? 0x400000 | 0x8 : 0);   //texture, mipmap, complex
+
+    FILE* file = fopen(path, "wb");
+    if(!file) {return false;}
+    fwrite(&ddsMagic, 4, 1, file);
+    fwrite(&header, sizeof(header), 1, file);
+
+    const unsigned char* level = (const unsigned char*)image.data;
+    for(int i = 0; i < image.mipmaps; i++)
+    {
+        const int width = image.width >> i > 0 ? image.width >> i : 1;
+        const int height = image.height >> i > 0 ? image.height >> i : 1;
+        if(compress)
+        {
+            const int size = packedLevelSize(width, height, format);
+            unsigned char* blocks = (unsigned char*)malloc(size);
+            encodeBC1(level, width, height, blocks);
+            fwrite(blocks, size, 1, file);
+            free(blocks);
+        }
+        else {fwrite(level, width*height*4, 1, file);}
+        level += width*height*4;
+    }
+
+    const bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+//every level of a texture savePackedTexture wrote, ready for
+//LoadTextureFromImage; data is null when the file is missing or not one of ours
+inline Image loadPackedTexture(const char* path)
+{
+    Image image = {};
+    int fileSize = 0;
+    unsigned char* file = LoadFileData(path, &fileSize);
+    if(!file) {return image;}
+
+    DDSHeader header = {};
+    uint32_t magic = 0;
+    if(fileSize >= 4 + (int)sizeof(header))
+    {
+        memcpy(&magic, file, 4);
+        memcpy(&header, file + 4, sizeof(header));
+    }
+
+    int format = 0;
+    if(magic == ddsMagic && header.size == 124)
+    {
+        if((header.formatFlags & 0x4) && header.fourCC == ddsFourCCDXT1) {format = PIXELFORMAT_COMPRESSED_DXT1_RGB;}
+        else if((header.formatFlags & 0x40) && header.rgbBitCount == 32 && header.rMask == 0x000000FF && header.aMask == 0xFF000000) {format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;}
+    }
+
+    const int mipmaps = header.mipmapCount > 0 ? header.mipmapCount : 1;
+    int dataSize = 0;
+    if(format)
+    {
+        for(int i = 0; i < mipmaps; i++)
+        {
+            const int width = header.width >> i > 0 ? header.width >> i : 1;
+            const int height = header.height >> i > 0 ? header.height >> i : 1;
+            dataSize += packedLevelSize(width, height, format);
+        }
+    }
+
+    if(format && 4 + (int)sizeof(header) + dataSize <= fileSize)
+    {
+        image.data = malloc(dataSize);
+        memcpy(image.data, file + 4 + sizeof(header), dataSize);
+        image.width = header.width;
+        image.height = header.height;
+        image.mipmaps = mipmaps;
+        image.format = format;
+    }
+    UnloadFileData(file);
+    return image;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+// Single-producer/single-consumer triple buffer. The writer always has a slot
+// of its own to fill, the reader always has a complete slot to read, and the
+// third slot is handed between them with one atomic exchange, so neither side
+// ever blocks or sees a half-written value.
+
+template<typename T>
+class TripleBuffer
+{
+    private:
+    static const int freshBit = 4;  //set on the shared index when it holds an unread publish
+
+    T slots[3];
+    int writeIndex;
+    int readIndex;
+    std::atomic<int> sharedIndex;
+
+    public:
+    TripleBuffer() : writeIndex(0), readIndex(1), sharedIndex(2) {}
+
+    //writer side: the slot to fill before the next publish()
+    T& writeBuffer()
+    {
+        return slots[writeIndex];
+    }
+
+    void publish()
+    {
+        writeIndex = sharedIndex.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+    }
+
+    //reader side: picks up the newest publish, if any; returns true when it changed
+    bool update()
+    {
+        if(!(sharedIndex.load(std::memory_order_relaxed) & freshBit)) {return false;}
+        readIndex = sharedIndex.exchange(readIndex, std::memory_order_acq_rel) & ~freshBit;
+        return true;
+    }
+
+    const T& read()
+    {
+        return slots[readIndex];
+    }
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <vector>
+#include "raylib.h"
+
+// Retained-mode UI: each screen builds its widgets once, text is measured
+// once at construction, and the whole screen is rendered into a cached
+// layer that is only redrawn when a widget's hover or value changes.
+
+class Widget
+{
+    protected:
+    int id;
+    bool interactive;
+
+    public:
+    Widget(int id = -1) : id(id), interactive(true) {}
+    virtual ~Widget() {}
+
+    int getId()
+    {
+        return id;
+    }
+
+    void setInteractive(bool value)
+    {
+        interactive = value;
+    }
+
+    bool isInteractive()
+    {
+        return interactive;
+    }
+
+    //polls input; returns true when the widget needs to be redrawn
+    virtual bool update() {return false;}
+    virtual bool clicked() {return false;}
+    virtual void draw() = 0;
+};
+
+class Panel : public Widget
+{
+    private:
+    Rectangle inner;
+    Rectangle outer;
+    Color color_main;
+    Color color_border;
+
+    public:
+    Panel(Rectangle rec, float borderLen = 10, Color color = WHITE, Color borderColor = BLACK) : inner(rec), color_main(color), color_border(borderColor)
+    {
+        outer = {rec.x - borderLen, rec.y - borderLen, rec.width + 2*borderLen, rec.height + 2*borderLen};
+        interactive = false;
+    }
+
+    void draw() override
+    {
+        DrawRectangleRec(outer, color_border);
+        DrawRectangleRec(inner, color_main);
+    }
+};
+
+class Label : public Widget
+{
+    private:
+    const char* text;
+    int textX;
+    int textY;
+    int textSize;
+    Color color_text;
+
+    public:
+    //centered labels use x as the horizontal center of the text
+    Label(const char* text, float x, float y, int fontSize, bool centered = false, Color textColor = BLACK) : text(text), textSize(fontSize), color_text(textColor)
+    {
+        textX = centered ? (int)(x - MeasureText(text, fontSize)/2.0f) : (int)x;
+        textY = (int)y;
+        interactive = false;
+    }
+
+    void draw() override
+    {
+        DrawText(text, textX, textY, textSize, color_text);
+    }
+};
+
+class Button : public Widget
+{
+    private:
+    Rectangle inner;
+    Rectangle outer;
+
+    Color color_main;
+    Color color_border;
+    Color color_hover;
+    Color color_text;
+
+    const char* name;
+
+    int textSize;
+    int textX;
+    int textY;
+
+    bool hover;
+    bool released;
+
+    public:
+    Button(int id, Vector2 pos, float width, float height , const char* name, int fontSize, float borderLen = 10, Color color = WHITE, Color borderColor = BLACK, Color hoverColor = GRAY, Color textColor = BLACK) : Widget(id)
+    {
+        inner = {pos.x, pos.y, width, height};
+        outer = {pos.x - borderLen, pos.y - borderLen, width + 2*borderLen, height + 2*borderLen};
+
+        this->color_main = color;
+        this->color_border = borderColor;
+        this->color_hover = hoverColor;
+        this->color_text = textColor;
+
+        this->name = name;
+
+        this->textSize = fontSize;
+        textX = (int)(inner.x + (inner.width - MeasureText(name, fontSize))/2.0f);
+        textY = (int)(inner.y + inner.height/2 - fontSize/2);
+
+        hover = false;
+        released = false;
+    }
+
+    bool update() override
+    {
+        bool wasHover = hover;
+        hover = CheckCollisionPointRec(GetMousePosition(), inner);
+        released = hover && IsMouseButtonReleased(MOUSE_BUTTON_LEFT);
+        return hover != wasHover;
+    }
+
+    bool clicked() override
+    {
+        return released;
+    }
+
+    //the owning screen has to be marked dirty after a rename
+    void setName(const char* newName)
+    {
+        name = newName;
+        textX = (int)(inner.x + (inner.width - MeasureText(name, textSize))/2.0f);
+    }
+
+    void draw() override
+    {
+        DrawRectangleRec(outer, color_border);
+        DrawRectangleRec(inner, hover ? color_hover : color_main);
+        DrawText(name, textX, textY, textSize, color_text);
+    }
+};
+
+class CheckBox : public Widget
+{
+    private:
+    Color color_border;
+    Color color_hover;
+    Color color_inside;
+    Color color_char;
+
+    Rectangle main;
+    Rectangle border;
+
+    int charX;
+
+    bool* value;
+    bool lastValue;
+    bool hover;
+
+    public:
+    CheckBox(int id, Rectangle rec, bool* value, Color borderColor = BLACK, Color mainColor = WHITE, Color charColor = BLACK, Color hoverColor = GRAY) : Widget(id), color_border(borderColor), color_hover(hoverColor), color_inside(mainColor), color_char(charColor), main(rec)
+    {
+        this->value = value;
+        lastValue = *value;
+        this->hover = false;
+
+        border.x = rec.x - 10;
+        border.y = rec.y - 10;
+
+        border.width = rec.width + 20;
+        border.height = rec.height + 20;
+
+        charX = (int)(rec.x + (rec.width - MeasureText("x", rec.height))/2.0f);
+    }
+
+    bool update() override
+    {
+        bool wasHover = hover;
+        hover = CheckCollisionPointRec(GetMousePosition(), main);
+        if(hover && IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+        {
+            *value = !(*value);
+        }
+
+        bool changed = hover != wasHover || *value != lastValue;
+        lastValue = *value;
+        return changed;
+    }
+
+    void draw() override
+    {
+        DrawRectangleRec(border, color_border);
+        DrawRectangleRec(main, hover ? color_hover : color_inside);
+
+        if(*value)
+        {
+            DrawText("x", charX, main.y, main.height, color_char);
+        }
+    }
+};
+
+//owns the widgets of one screen, in draw order
+class UiScreen
+{
+    private:
+    std::vector<Widget*> widgets;
+    bool dirty;
+
+    public:
+    UiScreen() : dirty(true) {}
+
+    template<typename T>
+    T* add(T* widget)
+    {
+        widgets.push_back(widget);
+        dirty = true;
+        return widget;
+    }
+
+    //returns the id of the widget clicked this frame, or -1
+    int update()
+    {
+        int clickedId = -1;
+        for(Widget* widget : widgets)
+        {
+            if(!widget->isInteractive()) {continue;}
+            if(widget->update()) {dirty = true;}
+            if(clickedId < 0 && widget->clicked()) {clickedId = widget->getId();}
+        }
+        return clickedId;
+    }
+
+    void markDirty()
+    {
+        dirty = true;
+    }
+
+    bool isDirty()
+    {
+        return dirty;
+    }
+
+    void draw()
+    {
+        for(Widget* widget : widgets)
+        {
+            widget->draw();
+        }
+        dirty = false;
+    }
+
+    ~UiScreen()
+    {
+        for(Widget* widget : widgets)
+        {
+            delete widget;
+        }
+    }
+};
+
+//screen-sized cache shared by all screens; only the visible screen is kept
+class UiLayer
+{
+    private:
+    RenderTexture2D target;
+    UiScreen* current;
+
+    public:
+    UiLayer(int width, int height)
+    {
+        target = LoadRenderTexture(width, height);
+        current = nullptr;
+    }
+
+    void draw(UiScreen& screen)
+    {
+        if(current != &screen || screen.isDirty())
+        {
+            BeginTextureMode(target);
+                ClearBackground(BLANK);
+                screen.draw();
+            EndTextureMode();
+            current = &screen;
+        }
+
+        DrawTextureRec(target.texture, {0, 0, (float)target.texture.width, -(float)target.texture.height}, {0, 0}, WHITE);
+    }
+
+    //called before CloseWindow, the GL context has to outlive the target
+    void unload()
+    {
+        UnloadRenderTexture(target);
+    }
+};